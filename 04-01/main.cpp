@@ -1,12 +1,42 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
 #include <cassert>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
 template <class T, class Compare, class Proj>
 inline bool cmp_less(const T& a, const T& b, Compare comp, Proj proj)
 {
@@ -21,8 +51,21 @@ inline bool cmp_greater(const T& a, const T& b, Compare comp, Proj proj)
     return cmp_less(b, a, comp, proj);
 }
 
+// The algorithms work on std::span<T>, so any contiguous buffer sorts in place:
+// std::vector, std::array, C arrays, memory-mapped or arena storage through a span,
+// an iterator pair through std::ranges::subrange.
+template <class R>
+concept contiguous_buffer = std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                            !std::is_const_v<std::remove_reference_t<std::ranges::range_reference_t<R>>>;
+
+template <contiguous_buffer R>
+inline std::span<std::ranges::range_value_t<R>> as_span(R&& r)
+{
+    return {std::ranges::data(r), std::ranges::size(r)};
+}
+
 template <class T, class Compare, class Proj>
-static void insertion_order(std::vector<T>& a,
+static void insertion_order(std::span<T> a,
                             std::size_t left,
                             std::size_t right,
                             Compare comp,
@@ -35,12 +78,12 @@ static void insertion_order(std::vector<T>& a,
 
     for (std::size_t i = left + 1U; i < right; ++i)
     {
-        T key = a[i];
+        T key = std::move(a[i]);
 
         std::size_t j = i;
         while (j > left && cmp_greater(a[j - 1U], key, comp, proj))
         {
-            a[j] = a[j - 1U];
+            a[j] = std::move(a[j - 1U]);
 
             --j;
         }
@@ -49,12 +92,14 @@ static void insertion_order(std::vector<T>& a,
     }
 }
 
+// index of the median of a[left], a[middle] and a[right - 1]; the pivot is then
+// used in place, never copied
 template <class T, class Compare, class Proj>
-static T pivot_median_of_three(const std::vector<T>& a,
-                               std::size_t left,
-                               std::size_t right,
-                               Compare comp,
-                               Proj proj)
+static std::size_t pivot_median_of_three(std::span<T> a,
+                                         std::size_t left,
+                                         std::size_t right,
+                                         Compare comp,
+                                         Proj proj)
 {
     const std::size_t last   = right - 1U;
 
@@ -72,173 +117,3735 @@ static T pivot_median_of_three(const std::vector<T>& a,
     const bool zy = cmp_less(z, y, comp, proj);
     const bool xz = cmp_less(x, z, comp, proj);
 
-    if ((xy && yz) || (zy && yx))
+    // non-strict checks, otherwise ties such as (1, 1, 2) pick the maximum
+    // and hoare_partition can return right - 1, so quick_split never shrinks
+    if ((!yx && !zy) || (!yz && !xy))
     {
-        return y;
+        return middle;
     }
 
-    if ((yx && xz) || (zx && xy))
+    if ((!xy && !zx) || (!xz && !yx))
     {
-        return x;
+        return left;
     }
 
-    return z;
+    return last;
 }
+
+// Hoare partition around the pivot stored in a[left], which stays put until the
+// scans cross and then moves to its final place.
+// Needs an element not less than the pivot somewhere in (left, right).
+// Returns the final pivot position: [left, p) <= pivot <= [p + 1, right).
 template <class T, class Compare, class Proj>
-static std::size_t hoare_partition(std::vector<T>& a,
+static std::size_t hoare_partition(std::span<T> a,
                                    std::size_t left,
                                    std::size_t right,
-                                   const T& pivot,
                                    Compare comp,
                                    Proj proj)
 {
+    const T& pivot = a[left];
+
     // i move from left to the right
     std::size_t i = left;
 
-    // j move from right-1 to the left
-    std::size_t j = right - 1U;
+    // j move from right to the left, a[left] itself stops it
+    std::size_t j = right;
 
     for (;;)
     {
-        while (cmp_less(a[i], pivot, comp, proj))
+        while (cmp_less(a[++i], pivot, comp, proj))
         {
-            ++i;
         }
 
-        while (cmp_greater(a[j], pivot, comp, proj))
+        while (cmp_greater(a[--j], pivot, comp, proj))
         {
-            --j;
         }
 
         if (i >= j)
         {
-            return j;
+            break;
         }
 
         std::swap(a[i], a[j]);
-        ++i;
-        --j;
+    }
+
+    std::swap(a[left], a[j]);
+    return j;
+}
+
+// moves num misplaced pairs across the split; when the counts differ a cyclic
+// rotation through one temporary replaces the swaps (half the moves)
+template <class T>
+static void swap_offsets(std::span<T> a,
+                         std::size_t first,
+                         std::size_t last,
+                         const unsigned char* offsets_l,
+                         const unsigned char* offsets_r,
+                         std::size_t num,
+                         bool use_swaps)
+{
+    if (use_swaps)
+    {
+        for (std::size_t i = 0U; i < num; ++i)
+        {
+            std::swap(a[first + offsets_l[i]], a[last - offsets_r[i]]);
+        }
+    }
+    else if (num > 0U)
+    {
+        std::size_t l = first + offsets_l[0];
+        std::size_t r = last - offsets_r[0];
+
+        T tmp(std::move(a[l]));
+        a[l] = std::move(a[r]);
+
+        for (std::size_t i = 1U; i < num; ++i)
+        {
+            l = first + offsets_l[i];
+            a[r] = std::move(a[l]);
+
+            r = last - offsets_r[i];
+            a[l] = std::move(a[r]);
+        }
+
+        a[r] = std::move(tmp);
     }
 }
 
+// BlockQuicksort / pdqsort style partition around the pivot stored in a[left].
+// Comparison results are only added to offset counters, so the scan loops have no
+// data-dependent branches; misplaced elements are then swapped in batches.
+// Needs an element not less than the pivot somewhere in (left, right).
+// Returns the final pivot position: [left, p) < pivot <= [p + 1, right).
 template <class T, class Compare, class Proj>
-static void quick_split(std::vector<T>& a,
-                        std::size_t left,
-                        std::size_t right,
-                        Compare comp,
-                        Proj proj)
+static std::size_t block_partition(std::span<T> a,
+                                   std::size_t left,
+                                   std::size_t right,
+                                   Compare comp,
+                                   Proj proj)
 {
-    constexpr std::size_t CUTOFF = 16U;
+    constexpr std::size_t BLOCK = 64U;
 
-    const std::size_t n = right - left;
+    T pivot(std::move(a[left]));
 
-    if (n <= 1U)
+    std::size_t first = left;
+    std::size_t last  = right;
+
+    while (cmp_less(a[++first], pivot, comp, proj))
     {
-        return;
     }
 
-    if (n <= CUTOFF)
+    // nothing smaller than the pivot was seen yet, so the right scan needs a bound
+    if (first - 1U == left)
     {
-        insertion_order(a, left, right, comp, proj);
-        return;
+        while (first < last && !cmp_less(a[--last], pivot, comp, proj))
+        {
+        }
+    }
+    else
+    {
+        while (!cmp_less(a[--last], pivot, comp, proj))
+        {
+        }
     }
 
-    const T pivot = pivot_median_of_three(a, left, right, comp, proj);
+    if (first < last)
+    {
+        std::swap(a[first], a[last]);
+        ++first;
+
+        alignas(64) unsigned char offsets_l[BLOCK];
+        alignas(64) unsigned char offsets_r[BLOCK];
+
+        std::size_t num_l   = 0U;
+        std::size_t num_r   = 0U;
+        std::size_t start_l = 0U;
+        std::size_t start_r = 0U;
+
+        while (last - first > 2U * BLOCK)
+        {
+            if (num_l == 0U)
+            {
+                start_l = 0U;
+                for (std::size_t i = 0U; i < BLOCK; ++i)
+                {
+                    offsets_l[num_l] = static_cast<unsigned char>(i);
+                    num_l += static_cast<std::size_t>(!cmp_less(a[first + i], pivot, comp, proj));
+                }
+            }
+
+            if (num_r == 0U)
+            {
+                start_r = 0U;
+                for (std::size_t i = 0U; i < BLOCK; ++i)
+                {
+                    offsets_r[num_r] = static_cast<unsigned char>(i + 1U);
+                    num_r += static_cast<std::size_t>(cmp_less(a[last - i - 1U], pivot, comp, proj));
+                }
+            }
+
+            const std::size_t num = std::min(num_l, num_r);
+            swap_offsets(a, first, last, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+
+            num_l   -= num;
+            num_r   -= num;
+            start_l += num;
+            start_r += num;
+
+            if (num_l == 0U)
+            {
+                first += BLOCK;
+            }
+
+            if (num_r == 0U)
+            {
+                last -= BLOCK;
+            }
+        }
+
+        // at most 2 * BLOCK unknown elements remain, split them between the two sides
+        std::size_t l_size = 0U;
+        std::size_t r_size = 0U;
+
+        const std::size_t unknown = (last - first) - ((num_r != 0U || num_l != 0U) ? BLOCK : 0U);
+
+        if (num_r != 0U)
+        {
+            l_size = unknown;
+            r_size = BLOCK;
+        }
+        else if (num_l != 0U)
+        {
+            l_size = BLOCK;
+            r_size = unknown;
+        }
+        else
+        {
+            l_size = unknown / 2U;
+            r_size = unknown - l_size;
+        }
+
+        if (unknown != 0U && num_l == 0U)
+        {
+            start_l = 0U;
+            for (std::size_t i = 0U; i < l_size; ++i)
+            {
+                offsets_l[num_l] = static_cast<unsigned char>(i);
+                num_l += static_cast<std::size_t>(!cmp_less(a[first + i], pivot, comp, proj));
+            }
+        }
+
+        if (unknown != 0U && num_r == 0U)
+        {
+            start_r = 0U;
+            for (std::size_t i = 0U; i < r_size; ++i)
+            {
+                offsets_r[num_r] = static_cast<unsigned char>(i + 1U);
+                num_r += static_cast<std::size_t>(cmp_less(a[last - i - 1U], pivot, comp, proj));
+            }
+        }
+
+        const std::size_t num = std::min(num_l, num_r);
+        swap_offsets(a, first, last, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+
+        num_l   -= num;
+        num_r   -= num;
+        start_l += num;
+        start_r += num;
+
+        if (num_l == 0U)
+        {
+            first += l_size;
+        }
+
+        if (num_r == 0U)
+        {
+            last -= r_size;
+        }
+
+        // one block still has misplaced elements, move them to the middle
+        if (num_l != 0U)
+        {
+            while (num_l-- > 0U)
+            {
+                std::swap(a[first + offsets_l[start_l + num_l]], a[--last]);
+            }
+            first = last;
+        }
+
+        if (num_r != 0U)
+        {
+            while (num_r-- > 0U)
+            {
+                std::swap(a[last - offsets_r[start_r + num_r]], a[first]);
+                ++first;
+            }
+            last = first;
+        }
+    }
 
-    const std::size_t mid = hoare_partition(a, left, right, pivot, comp, proj);
+    const std::size_t pivot_pos = first - 1U;
 
-    quick_split(a, left,      mid + 1U, comp, proj);
+    a[left]      = std::move(a[pivot_pos]);
+    a[pivot_pos] = std::move(pivot);
 
-    quick_split(a, mid + 1U,  right,    comp, proj);
+    return pivot_pos;
 }
 
-template <class T,
-          class Compare = std::less<>,
-          class Proj    = std::identity> static void sort(std::vector<T>& a, Compare comp = {}, Proj    proj = {})
+// Dutch flag partition around the pivot stored in a[left], for ranges with many
+// copies of the pivot key: the equal keys end up together and are never visited again.
+// Returns the equal run [lo_end, hi_begin): [left, lo_end) < pivot < [hi_begin, right).
+template <class T, class Compare, class Proj>
+static std::pair<std::size_t, std::size_t> three_way_partition(std::span<T> a,
+                                                               std::size_t left,
+                                                               std::size_t right,
+                                                               Compare comp,
+                                                               Proj proj)
 {
-    quick_split(a, 0U, a.size(), comp, proj);
+    const T& pivot = a[left];
+
+    // [left + 1, lt) < pivot, [lt, i) == pivot, [i, gt) unknown, [gt, right) > pivot
+    std::size_t lt = left + 1U;
+    std::size_t gt = right;
+
+    for (std::size_t i = lt; i < gt;)
+    {
+        if (cmp_less(a[i], pivot, comp, proj))
+        {
+            std::swap(a[lt++], a[i++]);
+        }
+        else if (cmp_greater(a[i], pivot, comp, proj))
+        {
+            std::swap(a[i], a[--gt]);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    std::swap(a[left], a[lt - 1U]);
+    return {lt - 1U, gt};
 }
 
+// max-heap over a[left, left + count), root and children are offsets from left
+template <class T, class Compare, class Proj>
+static void sift_down(std::span<T> a,
+                      std::size_t left,
+                      std::size_t root,
+                      std::size_t count,
+                      Compare comp,
+                      Proj proj)
+{
+    for (;;)
+    {
+        std::size_t child = 2U * root + 1U;
+        if (child >= count)
+        {
+            return;
+        }
 
-template <class T,
-          class Compare = std::less<>,
-          class Proj    = std::identity>
-static bool is_sorted_vec(const std::vector<T>& v,
-                          Compare comp = {},
-                          Proj    proj = {})
+        if (child + 1U < count && cmp_less(a[left + child], a[left + child + 1U], comp, proj))
+        {
+            ++child;
+        }
+
+        if (!cmp_less(a[left + root], a[left + child], comp, proj))
+        {
+            return;
+        }
+
+        std::swap(a[left + root], a[left + child]);
+        root = child;
+    }
+}
+
+template <class T, class Compare, class Proj>
+static void heap_order(std::span<T> a,
+                       std::size_t left,
+                       std::size_t right,
+                       Compare comp,
+                       Proj proj)
 {
-    if (v.size() < 2U)
+    const std::size_t count = right - left;
+
+    for (std::size_t root = count / 2U; root-- > 0U;)
     {
-        return true;
+        sift_down(a, left, root, count, comp, proj);
     }
 
-    for (std::size_t i = 1U; i < v.size(); ++i)
+    for (std::size_t end = count; end > 1U;)
     {
-        if (cmp_less(v[i], v[i - 1U], comp, proj))
+        --end;
+        std::swap(a[left], a[left + end]);
+        sift_down(a, left, 0U, end, comp, proj);
+    }
+}
+
+// comparators that order keys by their own operator<
+template <class Compare, class Key>
+inline constexpr bool natural_less_v = std::is_same_v<Compare, std::less<>> ||
+                                       std::is_same_v<Compare, std::less<Key>>;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SORT_X86_SIMD 1
+#else
+#define SORT_X86_SIMD 0
+#endif
+
+enum class simd_level
+{
+    none,
+    sse41,
+    avx2
+};
+
+inline simd_level detect_simd_level()
+{
+#if SORT_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return simd_level::avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return simd_level::sse41;
+    }
+#endif
+    return simd_level::none;
+}
+
+// probed once, the same binary still runs on hosts without AVX2
+inline simd_level cpu_simd_level()
+{
+    static const simd_level level = detect_simd_level();
+    return level;
+}
+
+#if SORT_X86_SIMD
+
+// W lanes of T in one register, written with GCC vector extensions: the same network
+// becomes AVX2 or SSE4.1 code depending on the target of the kernel it is inlined into.
+// Vectors only travel by reference, so no function boundary depends on the vector ABI.
+template <class T, std::size_t W>
+struct simd_lanes
+{
+    typedef T vec __attribute__((vector_size(W * sizeof(T))));
+
+    typedef std::conditional_t<sizeof(T) == 4U, std::int32_t, std::int64_t> lane_int;
+    typedef lane_int mask __attribute__((vector_size(W * sizeof(T))));
+};
+
+// lane l of out = lane l ^ J of v
+template <std::size_t J, class Vec, std::size_t... L>
+[[gnu::always_inline]] inline void xor_shuffle(const Vec& v, Vec& out, std::index_sequence<L...>)
+{
+    out = __builtin_shufflevector(v, v, (L ^ J)...);
+}
+
+// which lanes keep the larger key in step (K, J) of the bitonic network: the upper
+// lane of an ascending pair, the lower lane of a descending one
+template <class Mask, std::size_t K, std::size_t J, bool ASCENDING, class Lanes>
+struct bitonic_mask;
+
+template <class Mask, std::size_t K, std::size_t J, bool ASCENDING, std::size_t... L>
+struct bitonic_mask<Mask, K, J, ASCENDING, std::index_sequence<L...>>
+{
+    static constexpr bool ascending(std::size_t lane)
+    {
+        return (K < sizeof...(L)) ? ((lane & K) == 0U) : ASCENDING;
+    }
+
+    static constexpr Mask value = {(((L & J) != 0U) == ascending(L) ? -1 : 0)...};
+};
+
+template <class T, std::size_t W, std::size_t R, std::size_t K, std::size_t J>
+[[gnu::always_inline]] inline void bitonic_step(typename simd_lanes<T, W>::vec (&regs)[R])
+{
+    using lanes = simd_lanes<T, W>;
+    using vec   = typename lanes::vec;
+
+    for (std::size_t r = 0U; r < R; ++r)
+    {
+        const bool ascending = ((r * W) & K) == 0U;
+
+        if constexpr (J >= W)
         {
-            return false;
+            // partners sit in different registers: plain min / max of whole registers
+            constexpr std::size_t D = J / W;
+            if ((r & D) != 0U)
+            {
+                continue;
+            }
+
+            // on ties mn takes hi and mx takes lo, so -0.0 and 0.0 both survive
+            const vec mn = regs[r] < regs[r + D] ? regs[r] : regs[r + D];
+            const vec mx = regs[r] < regs[r + D] ? regs[r + D] : regs[r];
+
+            regs[r]     = ascending ? mn : mx;
+            regs[r + D] = ascending ? mx : mn;
+        }
+        else
+        {
+            vec partner;
+            xor_shuffle<J>(regs[r], partner, std::make_index_sequence<W>{});
+
+            const vec mn = regs[r] < partner ? regs[r] : partner;
+            const vec mx = regs[r] < partner ? partner : regs[r];
+
+            if (ascending)
+            {
+                regs[r] = bitonic_mask<typename lanes::mask, K, J, true, std::make_index_sequence<W>>::value ? mx : mn;
+            }
+            else
+            {
+                regs[r] = bitonic_mask<typename lanes::mask, K, J, false, std::make_index_sequence<W>>::value ? mx : mn;
+            }
         }
     }
-    return true;
 }
 
+template <class T, std::size_t W, std::size_t R, std::size_t K, std::size_t J>
+[[gnu::always_inline]] inline void bitonic_merge(typename simd_lanes<T, W>::vec (&regs)[R])
+{
+    bitonic_step<T, W, R, K, J>(regs);
+    if constexpr (J > 1U)
+    {
+        bitonic_merge<T, W, R, K, J / 2U>(regs);
+    }
+}
 
-struct Record // example
+template <class T, std::size_t W, std::size_t R, std::size_t K = 2U>
+[[gnu::always_inline]] inline void bitonic_network(typename simd_lanes<T, W>::vec (&regs)[R])
 {
-    int         id{};
-    std::string name{};
-    double      score{};
-};
+    bitonic_merge<T, W, R, K, K / 2U>(regs);
+    if constexpr (K < W * R)
+    {
+        bitonic_network<T, W, R, 2U * K>(regs);
+    }
+}
 
-int main()
+// sorts n <= N keys: the block is padded with the largest key, which sorts to the back
+template <class T, std::size_t W, std::size_t N>
+[[gnu::always_inline]] inline void network_block(T* data, std::size_t n)
 {
-    std::size_t n1 = 1'000U;
-    std::vector<int> v1(n1);
-    for (std::size_t i = 0U; i < n1; ++i)
-        v1[i] = static_cast<int>(n1 - i);
+    using vec = typename simd_lanes<T, W>::vec;
 
-    sort(v1);
-    assert(is_sorted_vec(v1));
+    constexpr T PAD = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                            : std::numeric_limits<T>::max();
 
-    std::size_t n2 = 2'001U;
-    std::vector<int> v2(n2);
-    for (std::size_t i = 0U; i < n2; ++i)
-        v2[i] = static_cast<int>((i * 37U) % 113U);
+    alignas(64) T buffer[N];
+    std::copy(data, data + n, buffer);
+    std::fill(buffer + n, buffer + N, PAD);
 
-    sort(v2);
-    assert(is_sorted_vec(v2));
+    vec regs[N / W];
+    std::memcpy(regs, buffer, sizeof(regs));
 
-    std::vector<std::string> words{"pear", "apple", "banana", "banana", "cherry", "apricot", "fig", "date"};
-    sort(words);
-    assert(is_sorted_vec(words));
+    bitonic_network<T, W, N / W>(regs);
 
-    std::vector<Record> people{
-        {3, "Ann", 87.5},
-        {1, "Bob", 91.2},
-        {2, "Eve", 74.1},
-        {4, "Zed", 87.5},
-    };
+    std::memcpy(buffer, regs, sizeof(regs));
+    std::copy(buffer, buffer + n, data);
+}
 
-    sort(people, std::less<>{}, [](const Record& r) { return r.score; });
-    assert(is_sorted_vec(people, std::less<>{}, [](const Record& r) { return r.score; }));
+template <class T, std::size_t W>
+[[gnu::always_inline]] inline void network_sort_lanes(T* data, std::size_t n)
+{
+    if (n <= 8U)
+    {
+        network_block<T, W, std::max<std::size_t>(8U, 2U * W)>(data, n);
+    }
+    else if (n <= 16U)
+    {
+        network_block<T, W, 16U>(data, n);
+    }
+    else
+    {
+        network_block<T, W, 32U>(data, n);
+    }
+}
 
-    std::cout << "All tests passed\n";
+template <class T>
+[[gnu::target("avx2")]] static void network_sort_avx2(T* data, std::size_t n)
+{
+    network_sort_lanes<T, 32U / sizeof(T)>(data, n);
+}
+
+template <class T>
+[[gnu::target("sse4.1")]] static void network_sort_sse41(T* data, std::size_t n)
+{
+    network_sort_lanes<T, 16U / sizeof(T)>(data, n);
+}
+
+// first i in [1, n) with data[i] < data[i - 1], n when there is none: four registers
+// of neighbours compared per step, the scalar loop pins the exact position
+template <class T, std::size_t W>
+[[gnu::always_inline]] inline std::size_t descent_lanes(const T* data, std::size_t n)
+{
+    using lanes = simd_lanes<T, W>;
+    using vec   = typename lanes::vec;
+    using mask  = typename lanes::mask;
 
-    std::cout << "\nEnter number of integers: ";
-    std::size_t n = 0U;
-    if (!(std::cin >> n) || n == 0U)
+    constexpr std::size_t STEP = 4U * W;
+
+    std::size_t i = 1U;
+    for (; i + STEP <= n; i += STEP)
     {
-        std::cout << "Invalid input\n";
-        return 0;
+        mask bad{};
+        for (std::size_t k = 0U; k < STEP; k += W)
+        {
+            vec cur;
+            vec next;
+            std::memcpy(&cur,  data + i + k - 1U, sizeof(vec));
+            std::memcpy(&next, data + i + k,      sizeof(vec));
+            bad |= next < cur;
+        }
+
+        typename lanes::lane_int any = 0;
+        for (std::size_t l = 0U; l < W; ++l)
+        {
+            any |= bad[l];
+        }
+        if (any != 0)
+        {
+            break;
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        if (data[i] < data[i - 1U])
+        {
+            return i;
+        }
+    }
+    return n;
+}
+
+template <class T>
+[[gnu::target("avx2")]] static std::size_t descent_avx2(const T* data, std::size_t n)
+{
+    return descent_lanes<T, 32U / sizeof(T)>(data, n);
+}
+
+template <class T>
+[[gnu::target("sse4.1")]] static std::size_t descent_sse41(const T* data, std::size_t n)
+{
+    return descent_lanes<T, 16U / sizeof(T)>(data, n);
+}
+
+#endif
+
+// the sorting networks cover these keys with the default comparator and projection
+template <class T, class Compare, class Proj>
+inline constexpr bool network_sortable_v = SORT_X86_SIMD &&
+                                           (std::is_same_v<T, std::int32_t> ||
+                                            std::is_same_v<T, float> ||
+                                            std::is_same_v<T, double>) &&
+                                           std::is_same_v<Proj, std::identity> &&
+                                           natural_less_v<Compare, T>;
+
+// sorts up to 32 keys with the best network this CPU runs; false when it has none
+template <class T>
+static bool network_sort(T* data, std::size_t n)
+{
+#if SORT_X86_SIMD
+    switch (cpu_simd_level())
+    {
+    case simd_level::avx2:
+        network_sort_avx2(data, n);
+        return true;
+    case simd_level::sse41:
+        network_sort_sse41(data, n);
+        return true;
+    case simd_level::none:
+        break;
     }
+#else
+    (void)data;
+    (void)n;
+#endif
+    return false;
+}
 
-    std::vector<int> user(n);
-    std::cout << "Enter " << n << " integers:\n";
-    for (std::size_t i = 0U; i < n; ++i) std::cin >> user[i];
+// keys the vectorised order check covers with the default comparator and projection
+template <class T, class Compare, class Proj>
+inline constexpr bool simd_scannable_v = SORT_X86_SIMD &&
+                                         std::is_arithmetic_v<T> &&
+                                         (sizeof(T) == 4U || sizeof(T) == 8U) &&
+                                         std::is_same_v<Proj, std::identity> &&
+                                         natural_less_v<Compare, T>;
 
-    sort(user);
+// pos = first i in [1, n) with data[i] < data[i - 1] (n when sorted); false when
+// this CPU has no vector unit to do it
+template <class T>
+static bool simd_descent(const T* data, std::size_t n, std::size_t& pos)
+{
+#if SORT_X86_SIMD
+    switch (cpu_simd_level())
+    {
+    case simd_level::avx2:
+        pos = descent_avx2(data, n);
+        return true;
+    case simd_level::sse41:
+        pos = descent_sse41(data, n);
+        return true;
+    case simd_level::none:
+        break;
+    }
+#else
+    (void)data;
+    (void)n;
+    (void)pos;
+#endif
+    return false;
+}
+
+// introsort budget: 2 * floor(log2(n)) levels of partitioning before heap_order
+inline std::size_t depth_budget(std::size_t n)
+{
+    return (n < 2U) ? 0U : 2U * (static_cast<std::size_t>(std::bit_width(n)) - 1U);
+}
+
+// partition schemes selectable on sort
+struct hoare_partition_policy {};
+struct block_partition_policy {};
+
+template <class Policy>
+inline constexpr bool partition_policy_v = std::is_same_v<Policy, hoare_partition_policy> ||
+                                           std::is_same_v<Policy, block_partition_policy>;
+
+// quick_split recurses into [left, lo_end) and [hi_begin, right)
+struct split_bounds
+{
+    std::size_t lo_end;
+    std::size_t hi_begin;
+};
+
+// partition_range overloads expect the pivot already in a[left]
+template <class T, class Compare, class Proj>
+static split_bounds partition_range(hoare_partition_policy,
+                                    std::span<T> a,
+                                    std::size_t left,
+                                    std::size_t right,
+                                    Compare comp,
+                                    Proj proj)
+{
+    const std::size_t p = hoare_partition(a, left, right, comp, proj);
+
+    return split_bounds{p, p + 1U};
+}
+
+template <class T, class Compare, class Proj>
+static split_bounds partition_range(block_partition_policy,
+                                    std::span<T> a,
+                                    std::size_t left,
+                                    std::size_t right,
+                                    Compare comp,
+                                    Proj proj)
+{
+    const std::size_t p = block_partition(a, left, right, comp, proj);
+
+    return split_bounds{p, p + 1U};
+}
+
+// Median of three goes to a[left], then the policy partitions around it.
+// Every range but the first has a predecessor not greater than any of its elements
+// (a pivot or a run of equal keys left by an earlier split); a pivot that does not
+// exceed it equals it, so the range is full of duplicates and the three-way
+// partition takes out all copies at once. Few distinct keys then cost O(n * k).
+// The three-way partition is correct for any pivot, a wrong guess only costs swaps.
+template <class T, class Compare, class Proj, class Policy>
+static split_bounds split_range(Policy policy,
+                                std::span<T> a,
+                                std::size_t left,
+                                std::size_t right,
+                                Compare comp,
+                                Proj proj)
+{
+    // the other two samples stay inside the range, one of them is not less than the
+    // median, which is the sentinel both partitions need
+    std::swap(a[left], a[pivot_median_of_three(a, left, right, comp, proj)]);
+
+    if (left > 0U && !cmp_less(a[left - 1U], a[left], comp, proj))
+    {
+        const auto [lo_end, hi_begin] = three_way_partition(a, left, right, comp, proj);
+        return split_bounds{lo_end, hi_begin};
+    }
+
+    return partition_range(policy, a, left, right, comp, proj);
+}
+
+template <class T, class Compare, class Proj, class Policy = hoare_partition_policy>
+static void quick_split(std::span<T> a,
+                        std::size_t left,
+                        std::size_t right,
+                        std::size_t depth,
+                        Compare comp,
+                        Proj proj,
+                        Policy policy = {})
+{
+    constexpr std::size_t CUTOFF = 16U;
+
+    const std::size_t n = right - left;
+
+    // one sorting network call replaces insertion_order and the last partitions
+    constexpr std::size_t NETWORK_CUTOFF = 32U;
+
+    if (n <= 1U)
+    {
+        return;
+    }
+
+    if constexpr (network_sortable_v<T, Compare, Proj>)
+    {
+        if (n <= NETWORK_CUTOFF && network_sort(a.data() + left, n))
+        {
+            return;
+        }
+    }
+
+    if (n <= CUTOFF)
+    {
+        insertion_order(a, left, right, comp, proj);
+        return;
+    }
+
+    // pivots keep landing near the ends, stop partitioning: O(n log n) worst case
+    if (depth == 0U)
+    {
+        heap_order(a, left, right, comp, proj);
+        return;
+    }
+
+    const split_bounds split = split_range(policy, a, left, right, comp, proj);
+
+    quick_split(a, left,           split.lo_end, depth - 1U, comp, proj, policy);
+
+    quick_split(a, split.hi_begin, right,        depth - 1U, comp, proj, policy);
+}
+
+// number of leading elements of base[0, len) that go before key: e <= key when
+// UPPER, e < key otherwise; exponential probe, then binary search in the last step
+template <bool UPPER, class T, class Compare, class Proj>
+static std::size_t gallop(const T& key, const T* base, std::size_t len, Compare comp, Proj proj)
+{
+    const auto goes_first = [&](const T& e)
+    {
+        return UPPER ? !cmp_less(key, e, comp, proj) : cmp_less(e, key, comp, proj);
+    };
+
+    std::size_t bound = 1U;
+    while (bound < len && goes_first(base[bound - 1U]))
+    {
+        bound *= 2U;
+    }
+
+    std::size_t lo = bound / 2U;
+    std::size_t hi = std::min(bound, len);
+    while (lo < hi)
+    {
+        const std::size_t mid = lo + (hi - lo) / 2U;
+        if (goes_first(base[mid]))
+        {
+            lo = mid + 1U;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// stable merge of the adjacent sorted runs [lo, mid) and [mid, hi); the left run is
+// moved to scratch and merged forward. After MIN_GALLOP straight wins of one side
+// the merge switches to galloping and moves whole stretches at once.
+template <class T, class Compare, class Proj>
+static void merge_runs(std::span<T> a,
+                       std::size_t lo,
+                       std::size_t mid,
+                       std::size_t hi,
+                       std::vector<T>& scratch,
+                       std::size_t& min_gallop,
+                       Compare comp,
+                       Proj proj)
+{
+    constexpr std::size_t MIN_GALLOP = 7U;
+
+    // left elements not greater than the first right one, and right elements not
+    // less than the last left one, are already in place
+    lo += gallop<true>(a[mid], a.data() + lo, mid - lo, comp, proj);
+    if (lo == mid)
+    {
+        return;
+    }
+    hi = mid + gallop<false>(a[mid - 1U], a.data() + mid, hi - mid, comp, proj);
+
+    scratch.assign(std::make_move_iterator(a.begin() + static_cast<std::ptrdiff_t>(lo)),
+                   std::make_move_iterator(a.begin() + static_cast<std::ptrdiff_t>(mid)));
+
+    T* const          left = scratch.data();
+    const std::size_t nl   = scratch.size();
+
+    std::size_t il   = 0U;
+    std::size_t ir   = mid;
+    std::size_t dest = lo;
+
+    while (il < nl && ir < hi)
+    {
+        std::size_t wins_l = 0U;
+        std::size_t wins_r = 0U;
+
+        while (il < nl && ir < hi && wins_l < min_gallop && wins_r < min_gallop)
+        {
+            if (cmp_less(a[ir], left[il], comp, proj))
+            {
+                a[dest++] = std::move(a[ir++]);
+                ++wins_r;
+                wins_l = 0U;
+            }
+            else
+            {
+                a[dest++] = std::move(left[il++]);
+                ++wins_l;
+                wins_r = 0U;
+            }
+        }
+
+        while (il < nl && ir < hi)
+        {
+            const std::size_t from_left = gallop<true>(a[ir], left + il, nl - il, comp, proj);
+            std::move(left + il, left + il + from_left, a.begin() + static_cast<std::ptrdiff_t>(dest));
+            il   += from_left;
+            dest += from_left;
+            if (il == nl)
+            {
+                break;
+            }
+
+            const std::size_t from_right = gallop<false>(left[il], a.data() + ir, hi - ir, comp, proj);
+            std::move(a.begin() + static_cast<std::ptrdiff_t>(ir),
+                      a.begin() + static_cast<std::ptrdiff_t>(ir + from_right),
+                      a.begin() + static_cast<std::ptrdiff_t>(dest));
+            ir   += from_right;
+            dest += from_right;
+
+            // galloping stopped paying off, make it harder to enter next time
+            if (from_left < MIN_GALLOP && from_right < MIN_GALLOP)
+            {
+                ++min_gallop;
+                break;
+            }
+
+            if (min_gallop > 1U)
+            {
+                --min_gallop;
+            }
+        }
+    }
+
+    // the rest of the right run is already in place
+    std::move(left + il, left + nl, a.begin() + static_cast<std::ptrdiff_t>(dest));
+}
+
+// length of the natural run starting at lo; a strictly descending run is reversed
+// in place (strictly, so equal elements keep their order)
+template <class T, class Compare, class Proj>
+static std::size_t natural_run(std::span<T> a,
+                               std::size_t lo,
+                               std::size_t hi,
+                               Compare comp,
+                               Proj proj)
+{
+    std::size_t i = lo + 1U;
+    if (i >= hi)
+    {
+        return hi;
+    }
+
+    if (cmp_less(a[i], a[lo], comp, proj))
+    {
+        while (i + 1U < hi && cmp_less(a[i + 1U], a[i], comp, proj))
+        {
+            ++i;
+        }
+        std::reverse(a.begin() + static_cast<std::ptrdiff_t>(lo),
+                     a.begin() + static_cast<std::ptrdiff_t>(i + 1U));
+    }
+    else
+    {
+        while (i + 1U < hi && !cmp_less(a[i + 1U], a[i], comp, proj))
+        {
+            ++i;
+        }
+    }
+    return i + 1U;
+}
+
+template <class T, class Proj>
+using projected_t = std::remove_cvref_t<std::invoke_result_t<Proj&, const T&>>;
+
+template <class Key>
+inline constexpr bool radix_key_v = std::is_arithmetic_v<Key> &&
+                                    !std::is_same_v<Key, bool> &&
+                                    !std::is_same_v<Key, long double>;
+
+template <class Key>
+using radix_bits_t = std::conditional_t<sizeof(Key) == 1U, std::uint8_t,
+                     std::conditional_t<sizeof(Key) == 2U, std::uint16_t,
+                     std::conditional_t<sizeof(Key) == 4U, std::uint32_t, std::uint64_t>>>;
+
+// maps a key to an unsigned integer with the same order:
+// signed integers flip the sign bit, negative floats flip every bit, positive floats only the sign bit
+template <class Key>
+inline radix_bits_t<Key> radix_bits(Key key)
+{
+    using Bits = radix_bits_t<Key>;
+    constexpr Bits SIGN = static_cast<Bits>(Bits{1} << (sizeof(Bits) * 8U - 1U));
+
+    if constexpr (std::is_floating_point_v<Key>)
+    {
+        const Bits bits = std::bit_cast<Bits>(key);
+        return ((bits & SIGN) != 0U) ? static_cast<Bits>(~bits) : static_cast<Bits>(bits | SIGN);
+    }
+    else if constexpr (std::is_signed_v<Key>)
+    {
+        return static_cast<Bits>(static_cast<Bits>(key) ^ SIGN);
+    }
+    else
+    {
+        return static_cast<Bits>(key);
+    }
+}
+
+template <class Key>
+inline Key radix_key(radix_bits_t<Key> bits)
+{
+    using Bits = radix_bits_t<Key>;
+    constexpr Bits SIGN = static_cast<Bits>(Bits{1} << (sizeof(Bits) * 8U - 1U));
+
+    if constexpr (std::is_floating_point_v<Key>)
+    {
+        return std::bit_cast<Key>(((bits & SIGN) != 0U) ? static_cast<Bits>(bits ^ SIGN) : static_cast<Bits>(~bits));
+    }
+    else if constexpr (std::is_signed_v<Key>)
+    {
+        return static_cast<Key>(static_cast<Bits>(bits ^ SIGN));
+    }
+    else
+    {
+        return static_cast<Key>(bits);
+    }
+}
+
+// scratch space of radix_sort, keep one around to sort repeatedly without allocating
+template <class T, class Key>
+struct radix_buffer
+{
+    std::vector<radix_bits_t<Key>> bits;
+    std::vector<radix_bits_t<Key>> bits_tmp;
+    std::vector<T>                 items_tmp;
+    std::vector<std::size_t>       order;
+    std::vector<std::size_t>       order_tmp;
+};
+
+// elements radix_sort moves along with their keys in every digit pass; anything
+// larger or with a non-trivial move only follows its index, then moves once
+template <class T, class Key>
+inline constexpr bool radix_moves_items_v = std::is_trivially_copyable_v<T> &&
+                                            sizeof(T) <= 2U * sizeof(Key);
+
+// LSD radix over 8-bit digits, stable; items (when WITH_ITEMS) follow every move of bits.
+// Returns true when the sorted sequence ended up in the scratch arrays.
+template <bool WITH_ITEMS, class Bits, class T>
+static bool radix_passes(std::vector<Bits>& bits,
+                         std::vector<Bits>& bits_tmp,
+                         T*                 items,
+                         T*                 items_tmp)
+{
+    constexpr std::size_t DIGITS = sizeof(Bits);
+    constexpr std::size_t RADIX  = 256U;
+
+    const std::size_t n = bits.size();
+
+    // histograms of every digit in one read of the keys
+    std::array<std::array<std::size_t, RADIX>, DIGITS> counts{};
+    for (const Bits b : bits)
+    {
+        for (std::size_t d = 0U; d < DIGITS; ++d)
+        {
+            ++counts[d][(b >> (8U * d)) & 0xFFU];
+        }
+    }
+
+    Bits* src  = bits.data();
+    Bits* dst  = bits_tmp.data();
+    T*    isrc = items;
+    T*    idst = items_tmp;
+
+    bool in_scratch = false;
+
+    for (std::size_t d = 0U; d < DIGITS; ++d)
+    {
+        std::array<std::size_t, RADIX>& offsets = counts[d];
+
+        const unsigned shift = static_cast<unsigned>(8U * d);
+
+        // every key has the same digit here, the pass would not move anything
+        if (offsets[(src[0] >> shift) & 0xFFU] == n)
+        {
+            continue;
+        }
+
+        std::size_t total = 0U;
+        for (std::size_t& slot : offsets)
+        {
+            const std::size_t count = slot;
+            slot   = total;
+            total += count;
+        }
+
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            const std::size_t pos = offsets[(src[i] >> shift) & 0xFFU]++;
+
+            dst[pos] = src[i];
+            if constexpr (WITH_ITEMS)
+            {
+                idst[pos] = std::move(isrc[i]);
+            }
+        }
+
+        std::swap(src, dst);
+        std::swap(isrc, idst);
+        in_scratch = !in_scratch;
+    }
+
+    return in_scratch;
+}
+
+// moves a[order[i]] to position i by following every cycle of the permutation once,
+// so each element is moved a single time; order is reset to the identity
+template <class T, class Index>
+static void apply_permutation(std::span<T> a, std::vector<Index>& order)
+{
+    for (std::size_t start = 0U; start < order.size(); ++start)
+    {
+        if (order[start] == start)
+        {
+            continue;
+        }
+
+        T tmp = std::move(a[start]);
+
+        std::size_t cur = start;
+        for (;;)
+        {
+            const std::size_t src = order[cur];
+            order[cur] = static_cast<Index>(cur);
+
+            if (src == start)
+            {
+                a[cur] = std::move(tmp);
+                break;
+            }
+
+            a[cur] = std::move(a[src]);
+            cur = src;
+        }
+    }
+}
+
+template <class T, class Key, class Proj = std::identity>
+static void radix_sort(std::span<T> a, radix_buffer<T, Key>& buffer, Proj proj = {})
+{
+    static_assert(radix_key_v<Key>, "radix_sort needs an integral or floating-point key");
+    static_assert(std::is_same_v<projected_t<T, Proj>, Key>,
+                  "radix_buffer key type must match the projected key");
+
+    const std::size_t n = a.size();
+    if (n < 2U)
+    {
+        return;
+    }
+
+    buffer.bits.resize(n);
+    buffer.bits_tmp.resize(n);
+
+    // plain keys: sort the mapped bits alone and map them back
+    if constexpr (std::is_same_v<T, Key> && std::is_same_v<Proj, std::identity>)
+    {
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            buffer.bits[i] = radix_bits(a[i]);
+        }
+
+        const bool in_scratch = radix_passes<false>(buffer.bits, buffer.bits_tmp, a.data(), a.data());
+
+        const std::vector<radix_bits_t<Key>>& sorted = in_scratch ? buffer.bits_tmp : buffer.bits;
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            a[i] = radix_key<Key>(sorted[i]);
+        }
+    }
+    else if constexpr (radix_moves_items_v<T, Key>)
+    {
+        buffer.items_tmp.resize(n);
+
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            buffer.bits[i] = radix_bits(static_cast<Key>(std::invoke(proj, a[i])));
+        }
+
+        if (radix_passes<true>(buffer.bits, buffer.bits_tmp, a.data(), buffer.items_tmp.data()))
+        {
+            std::move(buffer.items_tmp.begin(), buffer.items_tmp.end(), a.begin());
+        }
+    }
+    else
+    {
+        buffer.order.resize(n);
+        buffer.order_tmp.resize(n);
+
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            buffer.bits[i]  = radix_bits(static_cast<Key>(std::invoke(proj, a[i])));
+            buffer.order[i] = i;
+        }
+
+        const bool in_scratch = radix_passes<true>(buffer.bits, buffer.bits_tmp,
+                                                   buffer.order.data(), buffer.order_tmp.data());
+
+        apply_permutation(a, in_scratch ? buffer.order_tmp : buffer.order);
+    }
+}
+
+// one key of string_sort: the next 8 bytes from the current depth are cached
+// big-endian in prefix, so most comparisons never touch the string's heap buffer
+struct string_slot
+{
+    std::uint64_t    prefix{};
+    std::string_view key{};
+    std::size_t      index{};
+};
+
+// bytes past the end of the key read as zero
+inline std::uint64_t load_prefix(std::string_view key, std::size_t depth)
+{
+    std::uint64_t word = 0U;
+    for (std::size_t i = 0U; i < 8U; ++i)
+    {
+        word <<= 8U;
+        if (depth + i < key.size())
+        {
+            word |= static_cast<unsigned char>(key[depth + i]);
+        }
+    }
+    return word;
+}
+
+// three-way radix quicksort over 8-byte digits; every key in [left, right) shares
+// its first depth bytes and the prefixes are loaded for that depth
+static void multikey_split(std::span<string_slot> s,
+                           std::size_t left,
+                           std::size_t right,
+                           std::size_t depth,
+                           std::size_t budget)
+{
+    constexpr std::size_t CUTOFF = 16U;
+
+    for (;;)
+    {
+        const std::size_t n = right - left;
+        if (n <= 1U)
+        {
+            return;
+        }
+
+        const auto suffix_less = [depth](const string_slot& x, const string_slot& y)
+        {
+            if (x.prefix != y.prefix)
+            {
+                return x.prefix < y.prefix;
+            }
+            return x.key.substr(depth) < y.key.substr(depth);
+        };
+
+        if (n <= CUTOFF)
+        {
+            insertion_order(s, left, right, suffix_less, std::identity{});
+            return;
+        }
+
+        if (budget == 0U)
+        {
+            heap_order(s, left, right, suffix_less, std::identity{});
+            return;
+        }
+        --budget;
+
+        const std::uint64_t pivot = s[pivot_median_of_three(s, left, right, std::less<>{}, &string_slot::prefix)].prefix;
+
+        // Dutch flag: [left, lt) < pivot, [lt, gt) == pivot, [gt, right) > pivot
+        std::size_t lt = left;
+        std::size_t gt = right;
+        for (std::size_t i = left; i < gt;)
+        {
+            if (s[i].prefix < pivot)
+            {
+                std::swap(s[lt++], s[i++]);
+            }
+            else if (pivot < s[i].prefix)
+            {
+                std::swap(s[i], s[--gt]);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        multikey_split(s, left, lt,    depth, budget);
+        multikey_split(s, gt,   right, depth, budget);
+
+        // keys that end inside the shared 8 bytes are finished: a shorter one is a
+        // prefix of a longer one, so they go first, ordered by length
+        std::size_t done = lt;
+        for (std::size_t k = lt; k < gt; ++k)
+        {
+            if (s[k].key.size() <= depth + 8U)
+            {
+                std::swap(s[done++], s[k]);
+            }
+        }
+        quick_split(s, lt, done, depth_budget(done - lt), std::less<>{}, [](const string_slot& x) { return x.key.size(); });
+
+        depth += 8U;
+        for (std::size_t k = done; k < gt; ++k)
+        {
+            s[k].prefix = load_prefix(s[k].key, depth);
+        }
+
+        left   = done;
+        right  = gt;
+        budget = depth_budget(right - left);
+    }
+}
+
+// sorts by a std::string / std::string_view key in natural order
+template <class T, class Proj = std::identity>
+static void string_sort(std::span<T> a, Proj proj = {})
+{
+    using Result = std::invoke_result_t<Proj&, const T&>;
+
+    const std::size_t n = a.size();
+
+    // projections that build a temporary string keep it alive here
+    std::vector<std::string> owned;
+    std::vector<string_slot> slots(n);
+
+    if constexpr (std::is_lvalue_reference_v<Result> ||
+                  std::is_same_v<std::remove_cvref_t<Result>, std::string_view>)
+    {
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            slots[i].key = std::string_view(std::invoke(proj, a[i]));
+        }
+    }
+    else
+    {
+        owned.reserve(n);
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            owned.push_back(std::invoke(proj, a[i]));
+        }
+        for (std::size_t i = 0U; i < n; ++i)
+        {
+            slots[i].key = owned[i];
+        }
+    }
+
+    for (std::size_t i = 0U; i < n; ++i)
+    {
+        slots[i].prefix = load_prefix(slots[i].key, 0U);
+        slots[i].index  = i;
+    }
+
+    multikey_split(slots, 0U, n, 0U, depth_budget(n));
+
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0U; i < n; ++i)
+    {
+        order[i] = slots[i].index;
+    }
+    slots.clear();
+    slots.shrink_to_fit();
+
+    apply_permutation(a, order);
+}
+
+template <class Key>
+inline constexpr bool string_key_v = std::is_same_v<Key, std::string> ||
+                                     std::is_same_v<Key, std::string_view>;
+
+// sort picks radix_sort at compile time for arithmetic keys in natural order
+template <class T, class Compare, class Proj>
+inline constexpr bool radix_sortable_v = radix_key_v<projected_t<T, Proj>> &&
+                                         natural_less_v<Compare, projected_t<T, Proj>> &&
+                                         std::is_default_constructible_v<T> &&
+                                         std::is_move_assignable_v<T>;
+
+// already sorted input, a reversed one or a few long runs finish here in O(n)
+// (O(n log runs) with the merges) instead of being partitioned; an input with more
+// than MAX_RUNS runs is detected within its first MAX_RUNS runs and left alone
+template <class T, class Compare, class Proj>
+static bool presorted_runs(std::span<T> a, Compare comp, Proj proj)
+{
+    constexpr std::size_t MAX_RUNS = 8U;
+
+    // below this length a run is noise, not structure
+    constexpr std::size_t MIN_RUN = 64U;
+
+    const std::size_t n = a.size();
+
+    std::array<std::size_t, MAX_RUNS + 1U> bounds{};
+    std::size_t count = 0U;
+
+    for (std::size_t lo = 0U; lo < n;)
+    {
+        if (count == MAX_RUNS)
+        {
+            return false;
+        }
+
+        const std::size_t end = natural_run(a, lo, n, comp, proj);
+        if (end - lo < MIN_RUN && end != n)
+        {
+            return false;
+        }
+
+        bounds[++count] = end;
+        lo = end;
+    }
+
+    std::vector<T> scratch;
+    std::size_t    min_gallop = 7U;
+
+    // merge neighbouring runs pairwise until one is left
+    for (std::size_t width = 1U; width < count; width *= 2U)
+    {
+        for (std::size_t r = 0U; r + width < count; r += 2U * width)
+        {
+            merge_runs(a, bounds[r], bounds[r + width], bounds[std::min(r + 2U * width, count)],
+                       scratch, min_gallop, comp, proj);
+        }
+    }
+    return true;
+}
+
+// the radix engine takes its scratch from buffer, so a caller sorting many arrays
+// keeps one buffer and allocates only when an array outgrows it
+template <class T,
+          class Key,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort(std::span<T> a, radix_buffer<T, Key>& buffer, Compare comp = {}, Proj proj = {})
+{
+    static_assert(std::is_same_v<projected_t<T, Proj>, Key>,
+                  "radix_buffer key type must match the projected key");
+
+    if (presorted_runs(a, comp, proj))
+    {
+        return;
+    }
+
+    // below this size the digit passes cost more than comparisons
+    constexpr std::size_t RADIX_THRESHOLD = 512U;
+
+    // elements the radix engine moves by index are permuted in one final walk that
+    // misses the cache on every element once they outgrow it; comparisons win there
+    constexpr std::size_t RADIX_PERMUTE_BYTES = std::size_t{4} << 20U;
+
+    // string keys switch to the multikey quicksort from here on
+    constexpr std::size_t STRING_THRESHOLD = 64U;
+
+    if constexpr (radix_sortable_v<T, Compare, Proj>)
+    {
+        if (a.size() >= RADIX_THRESHOLD &&
+            (radix_moves_items_v<T, Key> || a.size() * sizeof(T) <= RADIX_PERMUTE_BYTES))
+        {
+            radix_sort(a, buffer, proj);
+            return;
+        }
+    }
+    else if constexpr (string_key_v<projected_t<T, Proj>> &&
+                       natural_less_v<Compare, projected_t<T, Proj>>)
+    {
+        if (a.size() >= STRING_THRESHOLD)
+        {
+            string_sort(a, proj);
+            return;
+        }
+    }
+
+    quick_split(a, 0U, a.size(), depth_budget(a.size()), comp, proj);
+}
+
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity> static void sort(std::span<T> a, Compare comp = {}, Proj    proj = {})
+{
+    // empty until the radix engine sizes it, so other keys allocate nothing
+    radix_buffer<T, projected_t<T, Proj>> buffer;
+    sort(a, buffer, comp, proj);
+}
+
+template <contiguous_buffer R,
+          class Key,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort(R&& a, radix_buffer<std::ranges::range_value_t<R>, Key>& buffer, Compare comp = {}, Proj proj = {})
+{
+    sort(as_span(a), buffer, comp, proj);
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort(R&& a, Compare comp = {}, Proj proj = {})
+{
+    sort(as_span(a), comp, proj);
+}
+
+template <class Key>
+struct cached_key
+{
+    Key         key{};
+    std::size_t index{};
+};
+
+// decorate-sort-undecorate: proj runs once per element instead of twice per comparison
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort_cached(std::span<T> a, Compare comp = {}, Proj proj = {})
+{
+    using Key = projected_t<T, Proj>;
+
+    std::vector<cached_key<Key>> keyed;
+    keyed.reserve(a.size());
+    for (std::size_t i = 0U; i < a.size(); ++i)
+    {
+        keyed.push_back(cached_key<Key>{std::invoke(proj, a[i]), i});
+    }
+
+    // arithmetic keys still reach the radix engine through the member projection
+    sort(keyed, comp, &cached_key<Key>::key);
+
+    std::vector<std::size_t> order(a.size());
+    for (std::size_t i = 0U; i < keyed.size(); ++i)
+    {
+        order[i] = keyed[i].index;
+    }
+    keyed.clear();
+    keyed.shrink_to_fit();
+
+    apply_permutation(a, order);
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort_cached(R&& a, Compare comp = {}, Proj proj = {})
+{
+    sort_cached(as_span(a), comp, proj);
+}
+
+template <class Index, class T, class Compare, class Proj>
+static void sort_by_index(std::span<T> a, Compare comp, Proj proj)
+{
+    std::vector<Index> order(a.size());
+    for (std::size_t i = 0U; i < order.size(); ++i)
+    {
+        order[i] = static_cast<Index>(i);
+    }
+
+    const auto key_of = [&a, &proj](Index i) -> decltype(auto)
+    {
+        return std::invoke(proj, a[i]);
+    };
+
+    // indices still take the radix or string engine when the key allows it
+    sort(order, comp, key_of);
+
+    apply_permutation(a, order);
+}
+
+// for heavyweight elements: only a compact index array is shuffled while sorting,
+// then every element is moved once along the cycles of the permutation.
+// sort_cached is the variant that also caches the keys next to the indices.
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort_indexed(std::span<T> a, Compare comp = {}, Proj proj = {})
+{
+    if (a.size() <= UINT32_MAX)
+    {
+        sort_by_index<std::uint32_t>(a, comp, proj);
+    }
+    else
+    {
+        sort_by_index<std::size_t>(a, comp, proj);
+    }
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort_indexed(R&& a, Compare comp = {}, Proj proj = {})
+{
+    sort_indexed(as_span(a), comp, proj);
+}
+
+// explicit partition scheme, always comparison based
+template <class Policy,
+          class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires partition_policy_v<Policy>
+static void sort(Policy policy, std::span<T> a, Compare comp = {}, Proj proj = {})
+{
+    if (presorted_runs(a, comp, proj))
+    {
+        return;
+    }
+
+    quick_split(a, 0U, a.size(), depth_budget(a.size()), comp, proj, policy);
+}
+
+template <class Policy,
+          contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires partition_policy_v<Policy>
+static void sort(Policy policy, R&& a, Compare comp = {}, Proj proj = {})
+{
+    sort(policy, as_span(a), comp, proj);
+}
+
+// quickselect: afterwards a[k] is the element sort would put there, nothing in
+// [0, k) is greater and nothing in (k, n) is less; only the side holding k is split
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void nth_element(std::span<T> a, std::size_t k, Compare comp = {}, Proj proj = {})
+{
+    constexpr std::size_t CUTOFF = 16U;
+
+    if (k >= a.size())
+    {
+        return;
+    }
+
+    std::size_t left  = 0U;
+    std::size_t right = a.size();
+    std::size_t depth = depth_budget(a.size());
+
+    while (right - left > CUTOFF)
+    {
+        if (depth == 0U)
+        {
+            heap_order(a, left, right, comp, proj);
+            return;
+        }
+        --depth;
+
+        const split_bounds split = split_range(hoare_partition_policy{}, a, left, right, comp, proj);
+
+        if (k < split.lo_end)
+        {
+            right = split.lo_end;
+        }
+        else if (k >= split.hi_begin)
+        {
+            left = split.hi_begin;
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    insertion_order(a, left, right, comp, proj);
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void nth_element(R&& a, std::size_t k, Compare comp = {}, Proj proj = {})
+{
+    nth_element(as_span(a), k, comp, proj);
+}
+
+// the k first elements in sorted order, the rest in unspecified order
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void partial_sort(std::span<T> a, std::size_t k, Compare comp = {}, Proj proj = {})
+{
+    k = std::min(k, a.size());
+    if (k == 0U)
+    {
+        return;
+    }
+
+    nth_element(a, k - 1U, comp, proj);
+    quick_split(a, 0U, k - 1U, depth_budget(k - 1U), comp, proj);
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void partial_sort(R&& a, std::size_t k, Compare comp = {}, Proj proj = {})
+{
+    partial_sort(as_span(a), k, comp, proj);
+}
+
+// streaming top_k: keeps the k elements that sort first among everything pushed,
+// in a max-heap whose root is the one to evict next; O(log k) per push, O(k) memory
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+class top_k_heap
+{
+private:
+    std::vector<T> m_heap;
+    std::size_t    m_k;
+    Compare        m_comp;
+    Proj           m_proj;
+
+public:
+    explicit top_k_heap(std::size_t k, Compare comp = {}, Proj proj = {})
+        : m_k(k), m_comp(comp), m_proj(proj)
+    {
+        m_heap.reserve(k);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_heap.size();
+    }
+
+    void push(const T& value)
+    {
+        if (m_heap.size() < m_k)
+        {
+            m_heap.push_back(value);
+
+            // sift up
+            std::size_t child = m_heap.size() - 1U;
+            while (child > 0U)
+            {
+                const std::size_t parent = (child - 1U) / 2U;
+                if (!cmp_less(m_heap[parent], m_heap[child], m_comp, m_proj))
+                {
+                    break;
+                }
+                std::swap(m_heap[parent], m_heap[child]);
+                child = parent;
+            }
+        }
+        else if (m_k != 0U && cmp_less(value, m_heap[0], m_comp, m_proj))
+        {
+            m_heap[0] = value;
+            sift_down(std::span(m_heap), 0U, 0U, m_heap.size(), m_comp, m_proj);
+        }
+    }
+
+    // the kept elements in sorted order; the heap is left empty
+    std::vector<T> take_sorted()
+    {
+        heap_order(std::span(m_heap), 0U, m_heap.size(), m_comp, m_proj);
+        return std::exchange(m_heap, std::vector<T>{});
+    }
+};
+
+// copy of the k elements that sort first, sorted. The input is read once front to back
+// through top_k_heap, so it may be a stream (std::views::istream, a generator) and
+// memory stays O(k) however long it is
+template <std::ranges::input_range R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static std::vector<std::ranges::range_value_t<R>> top_k(R&& r, std::size_t k, Compare comp = {}, Proj proj = {})
+{
+    using T = std::ranges::range_value_t<R>;
+
+    // the heap reserves k, a known length bounds that
+    if constexpr (std::ranges::sized_range<R>)
+    {
+        k = std::min(k, static_cast<std::size_t>(std::ranges::size(r)));
+    }
+
+    top_k_heap<T, Compare, Proj> heap(k, comp, proj);
+    for (auto&& value : r)
+    {
+        heap.push(value);
+    }
+    return heap.take_sorted();
+}
+
+// a vector handed over by rvalue is the caller's to reorder: selected in place instead
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static std::vector<T> top_k(std::vector<T>&& a, std::size_t k, Compare comp = {}, Proj proj = {})
+{
+    partial_sort(a, k, comp, proj);
+    a.resize(std::min(k, a.size()));
+    return std::move(a);
+}
+
+// runs shorter than this are extended with insertion_order, chosen so that
+// n / minrun is a power of two or slightly below it
+inline std::size_t min_run_length(std::size_t n)
+{
+    std::size_t odd = 0U;
+    while (n >= 64U)
+    {
+        odd |= n & 1U;
+        n >>= 1U;
+    }
+    return n + odd;
+}
+
+// natural-run merge sort in the style of TimSort; scratch only grows, so sorting
+// repeatedly with the same scratch does not allocate once it is large enough
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void stable_sort(std::span<T> a, std::vector<T>& scratch, Compare comp = {}, Proj proj = {})
+{
+    struct run
+    {
+        std::size_t lo;
+        std::size_t len;
+    };
+
+    const std::size_t n = a.size();
+    if (n < 2U)
+    {
+        return;
+    }
+
+    // run lengths on the stack grow at least like Fibonacci numbers
+    std::array<run, 96U> runs{};
+    std::size_t          count      = 0U;
+    std::size_t          min_gallop = 7U;
+
+    const auto merge_at = [&](std::size_t i)
+    {
+        merge_runs(a, runs[i].lo, runs[i + 1U].lo, runs[i + 1U].lo + runs[i + 1U].len,
+                   scratch, min_gallop, comp, proj);
+
+        runs[i].len += runs[i + 1U].len;
+        for (std::size_t k = i + 1U; k + 1U < count; ++k)
+        {
+            runs[k] = runs[k + 1U];
+        }
+        --count;
+    };
+
+    const std::size_t min_run = min_run_length(n);
+
+    for (std::size_t lo = 0U; lo < n;)
+    {
+        std::size_t end = natural_run(a, lo, n, comp, proj);
+        if (end - lo < min_run)
+        {
+            end = std::min(n, lo + min_run);
+            insertion_order(a, lo, end, comp, proj);
+        }
+
+        runs[count++] = run{lo, end - lo};
+        lo = end;
+
+        // keep run lengths decreasing faster than Fibonacci so merges stay balanced
+        while (count > 1U)
+        {
+            std::size_t i = count - 2U;
+            if ((i > 0U && runs[i - 1U].len <= runs[i].len + runs[i + 1U].len) ||
+                (i > 1U && runs[i - 2U].len <= runs[i - 1U].len + runs[i].len))
+            {
+                if (runs[i - 1U].len < runs[i + 1U].len)
+                {
+                    --i;
+                }
+                merge_at(i);
+            }
+            else if (runs[i].len <= runs[i + 1U].len)
+            {
+                merge_at(i);
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    while (count > 1U)
+    {
+        std::size_t i = count - 2U;
+        if (i > 0U && runs[i - 1U].len < runs[i + 1U].len)
+        {
+            --i;
+        }
+        merge_at(i);
+    }
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void stable_sort(R&& a, std::vector<std::ranges::range_value_t<R>>& scratch, Compare comp = {}, Proj proj = {})
+{
+    stable_sort(as_span(a), scratch, comp, proj);
+}
+
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires (!std::is_same_v<Compare, std::vector<T>>)
+static void stable_sort(std::span<T> a, Compare comp = {}, Proj proj = {})
+{
+    std::vector<T> scratch;
+    stable_sort(a, scratch, comp, proj);
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires (!std::is_same_v<Compare, std::vector<std::ranges::range_value_t<R>>>)
+static void stable_sort(R&& a, Compare comp = {}, Proj proj = {})
+{
+    stable_sort(as_span(a), comp, proj);
+}
+
+// MSD over the key columns: order[lo, hi) is sorted by column Key (sort picks radix,
+// the string engine or partitioning from the key type), then every run of equal
+// keys is sorted by the remaining key columns
+template <std::size_t Key, std::size_t... Rest, class Index, class Columns>
+static void sort_column_keys(std::span<Index> order, const Columns& columns)
+{
+    const auto column = as_span(std::get<Key>(columns));
+
+    using T = typename decltype(column)::value_type;
+
+    const auto key_of = [column](Index i) -> const T&
+    {
+        return column[i];
+    };
+
+    sort(order, std::less<>{}, key_of);
+
+    if constexpr (sizeof...(Rest) > 0U)
+    {
+        for (std::size_t lo = 0U; lo < order.size();)
+        {
+            std::size_t hi = lo + 1U;
+            while (hi < order.size() && !(column[order[lo]] < column[order[hi]]))
+            {
+                ++hi;
+            }
+            if (hi - lo > 1U)
+            {
+                sort_column_keys<Rest...>(order.subspan(lo, hi - lo), columns);
+            }
+            lo = hi;
+        }
+    }
+}
+
+// column[i] = old column[order[i]]; unlike the cycles of apply_permutation the reads
+// do not depend on each other, so the cache misses overlap
+template <class T, class Index>
+static void gather_column(std::span<T> column, std::span<const Index> order)
+{
+    std::vector<T> gathered;
+    gathered.reserve(column.size());
+    for (const Index i : order)
+    {
+        gathered.push_back(std::move(column[i]));
+    }
+    std::move(gathered.begin(), gathered.end(), column.begin());
+}
+
+template <class Index, std::size_t... Keys, class... Columns>
+static void sort_columns_by_index(const std::tuple<Columns...>& columns, std::size_t n)
+{
+    std::vector<Index> order(n);
+    for (std::size_t i = 0U; i < n; ++i)
+    {
+        order[i] = static_cast<Index>(i);
+    }
+
+    sort_column_keys<Keys...>(std::span(order), columns);
+
+    std::apply([&order](const Columns&... column)
+    {
+        (gather_column(as_span(column), std::span<const Index>(order)), ...);
+    }, columns);
+}
+
+// Columnar (struct of arrays) multi-key sort: the rows are ordered by column Keys[0],
+// ties by Keys[1], and so on, in natural ascending order; rows equal in every key
+// column end up in unspecified order. Only the key columns are read while a row
+// permutation is sorted, then each column is gathered once. Columns are contiguous
+// buffers or spans of equal length, e.g. sort_columns<2, 1, 0>(std::tie(ids, names, scores)).
+template <std::size_t... Keys, class... Columns>
+    requires (sizeof...(Keys) > 0U && ((Keys < sizeof...(Columns)) && ...) && (contiguous_buffer<Columns&> && ...))
+static void sort_columns(const std::tuple<Columns...>& columns)
+{
+    const std::size_t n = std::ranges::size(std::get<0>(columns));
+
+    std::apply([n](const Columns&... column)
+    {
+        if (((std::ranges::size(column) != n) || ...))
+        {
+            throw std::invalid_argument("sort_columns: columns differ in length");
+        }
+    }, columns);
+
+    if (n <= UINT32_MAX)
+    {
+        sort_columns_by_index<std::uint32_t, Keys...>(columns, n);
+    }
+    else
+    {
+        sort_columns_by_index<std::size_t, Keys...>(columns, n);
+    }
+}
+
+struct parallel_policy
+{
+    // ranges of at most grain elements are sorted by one worker with the serial sort
+    std::size_t grain   = 1U << 14U;
+
+    // 0 means std::thread::hardware_concurrency()
+    unsigned    threads = 0U;
+};
+
+// Parallel sample sort. Every worker classifies its own slice of the input against
+// splitters taken from a sorted sample, the slices are scattered into buckets in one
+// parallel pass, and the buckets become the first ranges of the work-stealing phase:
+// every worker owns a deque of pending ranges, pops its own work from the back and
+// steals the oldest (usually the largest) range from the front of another deque.
+// A range is finished by the serial sort, so radix and string keys keep their
+// engines; a bucket grown far past its share by duplicates is split first.
+template <class T, class Compare, class Proj>
+class split_pool
+{
+private:
+    // splitters per worker, and sample elements per splitter
+    static constexpr std::size_t BUCKETS_PER_WORKER = 8U;
+    static constexpr std::size_t OVERSAMPLING       = 32U;
+
+    // the split of a range looks at the element before it, so a range is split within
+    // its bucket: the one before the bucket may be moving in another worker's sort
+    struct range
+    {
+        std::size_t bucket;
+        std::size_t left;
+        std::size_t right;
+        std::size_t depth;
+    };
+
+    struct worker_queue
+    {
+        std::mutex        lock;
+        std::deque<range> ranges;
+    };
+
+    std::span<T>              m_data;
+    Compare                   m_comp;
+    Proj                      m_proj;
+    std::size_t               m_grain;
+    std::vector<worker_queue> m_queues;
+
+    // ranges that were pushed but are not fully sorted yet, and those still queued
+    std::atomic<std::size_t>  m_pending;
+    std::atomic<std::size_t>  m_queued;
+
+    // workers without a range to pop or steal sleep here
+    std::mutex                m_idle;
+    std::condition_variable   m_wake;
+
+    // sample sort state: indices of the splitters in m_data, the bucket of every
+    // element, per worker bucket counts, and the buffer the buckets are scattered into
+    std::vector<std::size_t>  m_splitters;
+    std::vector<std::uint8_t> m_bucket_of;
+    std::vector<std::size_t>  m_counts;
+    std::size_t               m_buckets;
+    T*                        m_buffer;
+    std::barrier<>            m_phase;
+
+public:
+    split_pool(std::span<T> a, std::size_t grain, unsigned threads, Compare comp, Proj proj)
+        : m_data(a), m_comp(comp), m_proj(proj), m_grain(std::max<std::size_t>(grain, 2U)), m_queues(threads),
+          m_pending(0U), m_queued(0U), m_buckets(1U), m_buffer(nullptr), m_phase(static_cast<std::ptrdiff_t>(threads))
+    {
+    }
+
+    split_pool(const split_pool&)            = delete;
+    split_pool& operator=(const split_pool&) = delete;
+
+    ~split_pool()
+    {
+        if (m_buffer != nullptr)
+        {
+            std::allocator<T>{}.deallocate(m_buffer, m_data.size());
+        }
+    }
+
+    void run()
+    {
+        choose_splitters();
+
+        m_bucket_of.resize(m_data.size());
+        m_counts.assign(m_queues.size() * m_buckets, 0U);
+        // raw storage: an element lives in it only between its scatter and its move back
+        m_buffer = std::allocator<T>{}.allocate(m_data.size());
+
+        std::vector<std::thread> helpers;
+        helpers.reserve(m_queues.size() - 1U);
+        for (std::size_t self = 1U; self < m_queues.size(); ++self)
+        {
+            helpers.emplace_back([this, self] { worker(self); });
+        }
+
+        worker(0U);
+
+        for (std::thread& helper : helpers)
+        {
+            helper.join();
+        }
+    }
+
+private:
+    std::size_t slice_begin(std::size_t self) const
+    {
+        return m_data.size() * self / m_queues.size();
+    }
+
+    // m_buckets - 1 splitters, evenly spaced in a sorted sample of element indices;
+    // m_buckets is a power of two
+    void choose_splitters()
+    {
+        const std::size_t wanted = std::min<std::size_t>(std::bit_ceil(m_queues.size() * BUCKETS_PER_WORKER), 256U);
+        const std::size_t count  = std::min(m_data.size(), wanted * OVERSAMPLING);
+
+        std::mt19937 gen(static_cast<std::mt19937::result_type>(m_data.size()));
+        std::uniform_int_distribution<std::size_t> pick(0U, m_data.size() - 1U);
+
+        std::vector<std::size_t> sample(count);
+        for (std::size_t& index : sample)
+        {
+            index = pick(gen);
+        }
+        sort(sample, m_comp, [this](std::size_t index) -> decltype(auto) { return std::invoke(m_proj, m_data[index]); });
+
+        for (std::size_t b = 1U; b < wanted; ++b)
+        {
+            m_splitters.push_back(sample[b * count / wanted]);
+        }
+        m_buckets = m_splitters.size() + 1U;
+    }
+
+    // number of splitters not greater than a[i], so keys equal to a splitter all land
+    // in one bucket, to the right of it. The halving steps have a fixed count and no
+    // branch on the comparison, which would mispredict on every other step
+    std::size_t bucket(std::size_t i) const
+    {
+        std::size_t b = 0U;
+        for (std::size_t step = m_buckets / 2U; step > 0U; step /= 2U)
+        {
+            b += cmp_less(m_data[i], m_data[m_splitters[b + step - 1U]], m_comp, m_proj) ? 0U : step;
+        }
+        return b;
+    }
+
+    void worker(std::size_t self)
+    {
+        const std::size_t first = slice_begin(self);
+        const std::size_t last  = slice_begin(self + 1U);
+
+        std::size_t* counts = m_counts.data() + self * m_buckets;
+        for (std::size_t i = first; i < last; ++i)
+        {
+            const std::size_t b = bucket(i);
+            m_bucket_of[i] = static_cast<std::uint8_t>(b);
+            ++counts[b];
+        }
+        m_phase.arrive_and_wait();
+
+        // this worker's part of bucket b starts after the whole of buckets < b and after
+        // the parts of bucket b from lower slices
+        std::vector<std::size_t> next(m_buckets + 1U, 0U);
+        std::size_t start = 0U;
+        for (std::size_t b = 0U; b < m_buckets; ++b)
+        {
+            next[b] = start;
+            for (std::size_t w = 0U; w < m_queues.size(); ++w)
+            {
+                if (w < self)
+                {
+                    next[b] += m_counts[w * m_buckets + b];
+                }
+                start += m_counts[w * m_buckets + b];
+            }
+        }
+        for (std::size_t i = first; i < last; ++i)
+        {
+            std::construct_at(m_buffer + next[m_bucket_of[i]]++, std::move(m_data[i]));
+        }
+        m_phase.arrive_and_wait();
+
+        for (std::size_t i = first; i < last; ++i)
+        {
+            m_data[i] = std::move(m_buffer[i]);
+            std::destroy_at(m_buffer + i);
+        }
+
+        // every worker queues the buckets congruent to it, before the others may look
+        std::size_t left = 0U;
+        for (std::size_t b = 0U; b < m_buckets; ++b)
+        {
+            std::size_t size = 0U;
+            for (std::size_t w = 0U; w < m_queues.size(); ++w)
+            {
+                size += m_counts[w * m_buckets + b];
+            }
+            if (b % m_queues.size() == self && size > 1U)
+            {
+                push(self, range{left, left, left + size, depth_budget(size)});
+            }
+            left += size;
+        }
+        m_phase.arrive_and_wait();
+
+        work(self);
+    }
+
+    void push(std::size_t self, range r)
+    {
+        m_pending.fetch_add(1U, std::memory_order_relaxed);
+        {
+            const std::lock_guard<std::mutex> guard(m_queues[self].lock);
+            m_queues[self].ranges.push_back(r);
+        }
+        m_queued.fetch_add(1U, std::memory_order_release);
+
+        // a sleeper checks m_queued under m_idle, so it cannot miss this wakeup
+        { const std::lock_guard<std::mutex> guard(m_idle); }
+        m_wake.notify_one();
+    }
+
+    bool pop(std::size_t self, range& r)
+    {
+        const std::lock_guard<std::mutex> guard(m_queues[self].lock);
+        if (m_queues[self].ranges.empty())
+        {
+            return false;
+        }
+
+        r = m_queues[self].ranges.back();
+        m_queues[self].ranges.pop_back();
+        m_queued.fetch_sub(1U, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(std::size_t self, range& r)
+    {
+        for (std::size_t k = 1U; k < m_queues.size(); ++k)
+        {
+            worker_queue& victim = m_queues[(self + k) % m_queues.size()];
+
+            const std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.ranges.empty())
+            {
+                r = victim.ranges.front();
+                victim.ranges.pop_front();
+                m_queued.fetch_sub(1U, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t self)
+    {
+        range r{};
+        while (m_pending.load(std::memory_order_acquire) != 0U)
+        {
+            if (pop(self, r) || steal(self, r))
+            {
+                process(self, r);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_idle);
+            m_wake.wait(lock, [this]
+            {
+                return m_pending.load(std::memory_order_acquire) == 0U ||
+                       m_queued.load(std::memory_order_acquire) != 0U;
+            });
+        }
+    }
+
+    void process(std::size_t self, range r)
+    {
+        // a bucket holds about n / m_buckets elements; one swollen by duplicates keeps
+        // its left half and publishes the right half for the other workers
+        const std::size_t leaf = std::max(m_grain, 2U * m_data.size() / m_buckets);
+        const std::span<T> bucket = m_data.subspan(r.bucket);
+        while (r.right - r.left > leaf && r.depth > 0U)
+        {
+            const split_bounds split = split_range(hoare_partition_policy{}, bucket, r.left - r.bucket, r.right - r.bucket,
+                                                   m_comp, m_proj);
+
+            --r.depth;
+            push(self, range{r.bucket, r.bucket + split.hi_begin, r.right, r.depth});
+            r.right = r.bucket + split.lo_end;
+        }
+
+        sort(m_data.subspan(r.left, r.right - r.left), m_comp, m_proj);
+
+        if (m_pending.fetch_sub(1U, std::memory_order_acq_rel) == 1U)
+        {
+            { const std::lock_guard<std::mutex> guard(m_idle); }
+            m_wake.notify_all();
+        }
+    }
+};
+
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort(const parallel_policy& policy, std::span<T> a, Compare comp = {}, Proj proj = {})
+{
+    const unsigned threads = (policy.threads != 0U) ? policy.threads : std::thread::hardware_concurrency();
+
+    // one worker gains nothing from splitting the input
+    if (threads <= 1U || a.size() <= policy.grain)
+    {
+        sort(a, comp, proj);
+        return;
+    }
+
+    if (presorted_runs(a, comp, proj))
+    {
+        return;
+    }
+
+    split_pool<T, Compare, Proj> pool(a, policy.grain, threads, comp, proj);
+    pool.run();
+}
+
+template <contiguous_buffer R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void sort(const parallel_policy& policy, R&& a, Compare comp = {}, Proj proj = {})
+{
+    sort(policy, as_span(a), comp, proj);
+}
+
+
+using file_handle = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+inline file_handle open_file(const std::filesystem::path& path, const char* mode)
+{
+    file_handle file(std::fopen(path.string().c_str(), mode), &std::fclose);
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + path.string());
+    }
+    return file;
+}
+
+// reads up to block.capacity() records, block.size() is the number read.
+// Throws on a read error or when the file ends in the middle of a record,
+// so neither can pass for a clean end of file
+template <class T>
+static void read_block(std::FILE* file, std::vector<T>& block)
+{
+    block.resize(block.capacity());
+
+    const std::size_t bytes = std::fread(block.data(), 1U, block.size() * sizeof(T), file);
+    if (std::ferror(file))
+    {
+        throw std::runtime_error("read error while loading records");
+    }
+    if (bytes % sizeof(T) != 0U)
+    {
+        throw std::runtime_error("file ends inside a record");
+    }
+
+    block.resize(bytes / sizeof(T));
+}
+
+template <class T>
+static void write_block(std::FILE* file, const std::vector<T>& block)
+{
+    if (std::fwrite(block.data(), sizeof(T), block.size(), file) != block.size())
+    {
+        throw std::runtime_error("short write while spilling records");
+    }
+}
+
+// buffered data is only known to be written once the flush succeeded
+inline void flush_file(std::FILE* file)
+{
+    if (std::fflush(file) != 0)
+    {
+        throw std::runtime_error("cannot flush written records");
+    }
+}
+
+// private directory for the run files of one external_sort. create_directory fails
+// when the name is taken, so concurrent sorts (also from other processes) never share
+// one, and the destructor removes it with every run on success and on exceptions alike
+class spill_area
+{
+private:
+    std::filesystem::path m_dir;
+
+public:
+    explicit spill_area(const std::filesystem::path& parent)
+    {
+        std::random_device seed;
+        std::mt19937_64    gen((std::uint64_t{seed()} << 32U) ^ seed() ^
+                               static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+
+        for (int attempt = 0; attempt < 64; ++attempt)
+        {
+            std::filesystem::path dir = parent / ("external_sort." + std::to_string(gen()));
+            if (std::filesystem::create_directory(dir))
+            {
+                m_dir = std::move(dir);
+                return;
+            }
+        }
+        throw std::runtime_error("cannot create a spill directory in " + parent.string());
+    }
+
+    spill_area(const spill_area&)            = delete;
+    spill_area& operator=(const spill_area&) = delete;
+
+    ~spill_area()
+    {
+        std::error_code ignored;
+        std::filesystem::remove_all(m_dir, ignored);
+    }
+
+    const std::filesystem::path& dir() const
+    {
+        return m_dir;
+    }
+
+    std::filesystem::path run(std::size_t index) const
+    {
+        return m_dir / ("run" + std::to_string(index));
+    }
+};
+
+// k-way tournament: tree[0] holds the source with the smallest head, every inner node
+// the loser of the match played there, so replacing the winner replays one path
+template <class T, class Compare, class Proj>
+class loser_tree
+{
+private:
+    struct source
+    {
+        file_handle    file;
+        std::vector<T> block;
+        std::size_t    pos;
+    };
+
+    std::vector<source>      m_sources;
+    std::vector<std::size_t> m_tree;
+    Compare                  m_comp;
+    Proj                     m_proj;
+
+public:
+    loser_tree(std::vector<file_handle> files, std::size_t block_records, Compare comp, Proj proj)
+        : m_tree(files.size()), m_comp(comp), m_proj(proj)
+    {
+        m_sources.reserve(files.size());
+        for (file_handle& file : files)
+        {
+            source src{std::move(file), {}, 0U};
+            src.block.reserve(block_records);
+            read_block(src.file.get(), src.block);
+            m_sources.push_back(std::move(src));
+        }
+
+        if (!m_sources.empty())
+        {
+            m_tree[0] = build(1U);
+        }
+    }
+
+    bool empty() const
+    {
+        return m_sources.empty() || exhausted(m_tree[0]);
+    }
+
+    const T& top() const
+    {
+        const source& src = m_sources[m_tree[0]];
+        return src.block[src.pos];
+    }
+
+    void pop()
+    {
+        std::size_t winner = m_tree[0];
+        advance(winner);
+
+        const std::size_t k = m_sources.size();
+        for (std::size_t node = (winner + k) / 2U; node > 0U; node /= 2U)
+        {
+            if (beats(m_tree[node], winner))
+            {
+                std::swap(m_tree[node], winner);
+            }
+        }
+        m_tree[0] = winner;
+    }
+
+private:
+    bool exhausted(std::size_t i) const
+    {
+        return m_sources[i].pos >= m_sources[i].block.size();
+    }
+
+    // exhausted sources lose every match, ties go to the earlier run
+    bool beats(std::size_t i, std::size_t j) const
+    {
+        if (exhausted(i) || exhausted(j))
+        {
+            return !exhausted(i) || (exhausted(j) && i < j);
+        }
+
+        const T& x = m_sources[i].block[m_sources[i].pos];
+        const T& y = m_sources[j].block[m_sources[j].pos];
+
+        if (cmp_less(x, y, m_comp, m_proj))
+        {
+            return true;
+        }
+        return !cmp_less(y, x, m_comp, m_proj) && i < j;
+    }
+
+    // leaves sit at k .. 2k - 1 of the implicit tree, inner nodes at 1 .. k - 1
+    std::size_t build(std::size_t node)
+    {
+        const std::size_t k = m_sources.size();
+        if (node >= k)
+        {
+            return node - k;
+        }
+
+        const std::size_t l = build(2U * node);
+        const std::size_t r = build(2U * node + 1U);
+
+        if (beats(l, r))
+        {
+            m_tree[node] = r;
+            return l;
+        }
+        m_tree[node] = l;
+        return r;
+    }
+
+    void advance(std::size_t i)
+    {
+        source& src = m_sources[i];
+        if (++src.pos == src.block.size())
+        {
+            read_block(src.file.get(), src.block);
+            src.pos = 0U;
+        }
+    }
+};
+
+// merges sorted run files into output through a loser_tree while the previous output
+// block is written on a background thread; ties leave in the order of runs
+template <class T, class Compare, class Proj>
+static void merge_run_files(const std::vector<std::filesystem::path>& runs,
+                            const std::filesystem::path&              output,
+                            std::size_t                               block_records,
+                            Compare                                   comp,
+                            Proj                                      proj)
+{
+    std::vector<file_handle> files;
+    files.reserve(runs.size());
+    for (const std::filesystem::path& run : runs)
+    {
+        files.push_back(open_file(run, "rb"));
+    }
+
+    loser_tree<T, Compare, Proj> tree(std::move(files), block_records, comp, proj);
+
+    file_handle out = open_file(output, "wb");
+
+    std::array<std::vector<T>, 2U> blocks;
+    blocks[0].reserve(block_records);
+    blocks[1].reserve(block_records);
+
+    std::future<void> writing;
+    std::size_t       turn = 0U;
+
+    const auto flush = [&]
+    {
+        if (writing.valid())
+        {
+            writing.get();
+        }
+
+        writing = std::async(std::launch::async, [&out, &block = blocks[turn]]
+        {
+            write_block(out.get(), block);
+        });
+
+        turn ^= 1U;
+        blocks[turn].clear();
+    };
+
+    while (!tree.empty())
+    {
+        blocks[turn].push_back(tree.top());
+        tree.pop();
+
+        if (blocks[turn].size() == block_records)
+        {
+            flush();
+        }
+    }
+
+    if (!blocks[turn].empty())
+    {
+        flush();
+    }
+
+    if (writing.valid())
+    {
+        writing.get();
+    }
+
+    flush_file(out.get());
+}
+
+// descriptors one merge may hold: half the soft limit, so whatever else the process
+// keeps open still fits. Without getrlimit, 256 stays well below the 512 streams
+// stdio allows on Windows
+inline std::size_t open_file_budget()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        return limit.rlim_cur == RLIM_INFINITY ? std::numeric_limits<std::size_t>::max()
+                                               : static_cast<std::size_t>(limit.rlim_cur) / 2U;
+    }
+#endif
+    return 256U;
+}
+
+// runs merged at once by external_sort: each holds a descriptor and a block of at
+// least MIN_BLOCK bytes of the budget, next to the two output blocks. Never below
+// two, a tiny budget just merges in more passes
+inline std::size_t merge_fan_in(std::size_t memory_budget)
+{
+    constexpr std::size_t MIN_BLOCK = 64U * 1024U;
+
+    const std::size_t blocks    = memory_budget / MIN_BLOCK;
+    const std::size_t by_memory = blocks > 2U ? blocks - 2U : 0U;
+
+    return std::max<std::size_t>(std::min(by_memory, open_file_budget()), 2U);
+}
+
+// sorts a binary file of fixed-width records that does not fit in memory.
+// Chunks of half the budget are read and sorted with quick_split while the previous
+// sorted chunk is spilled to a run file on a background thread; the runs are then
+// merged through a loser_tree, again writing the output on a background thread.
+// More runs than merge_fan_in are first merged in passes into fewer, longer runs.
+// Plain buffered reads are used instead of memory mapping to stay portable.
+// Runs go to a private subdirectory of spill_dir, which defaults to the directory of
+// the output: it has to hold the same amount of data, /tmp often cannot.
+template <class T,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+static void external_sort(const std::filesystem::path& input,
+                          const std::filesystem::path& output,
+                          std::size_t memory_budget,
+                          const std::filesystem::path& spill_dir = {},
+                          Compare comp = {},
+                          Proj proj = {})
+{
+    static_assert(std::is_trivially_copyable_v<T>, "external_sort needs fixed-width records");
+
+    const std::size_t chunk_records = std::max<std::size_t>(memory_budget / sizeof(T) / 2U, 1U);
+
+    const spill_area spill(!spill_dir.empty()         ? spill_dir :
+                           output.has_parent_path()   ? output.parent_path() :
+                                                        std::filesystem::path("."));
+
+    std::vector<std::filesystem::path> runs;
+
+    {
+        file_handle in = open_file(input, "rb");
+
+        std::array<std::vector<T>, 2U> chunks;
+        chunks[0].reserve(chunk_records);
+        chunks[1].reserve(chunk_records);
+
+        std::future<void> spilling;
+
+        for (std::size_t turn = 0U;; turn ^= 1U)
+        {
+            std::vector<T>& chunk = chunks[turn];
+
+            read_block(in.get(), chunk);
+            if (chunk.empty())
+            {
+                break;
+            }
+
+            quick_split(std::span(chunk), 0U, chunk.size(), depth_budget(chunk.size()), comp, proj);
+
+            // the other buffer is free again once its spill finished
+            if (spilling.valid())
+            {
+                spilling.get();
+            }
+
+            runs.push_back(spill.run(runs.size()));
+            spilling = std::async(std::launch::async, [&chunk, path = runs.back()]
+            {
+                file_handle run = open_file(path, "wb");
+                write_block(run.get(), chunk);
+                flush_file(run.get());
+            });
+        }
+
+        if (spilling.valid())
+        {
+            spilling.get();
+        }
+    }
+
+    const std::size_t fan_in = merge_fan_in(memory_budget);
+
+    // the whole budget is shared by one block per merged run plus two output blocks
+    const std::size_t block_records =
+        std::max<std::size_t>(memory_budget / sizeof(T) / (std::min(fan_in, runs.size()) + 2U), 1U);
+
+    // too many runs for one merge: fan_in neighbouring runs at a time become one longer
+    // run, each deleted once merged, until a single merge is left
+    std::size_t next_run = runs.size();
+    while (runs.size() > fan_in)
+    {
+        std::vector<std::filesystem::path> longer;
+        for (std::size_t first = 0U; first < runs.size(); first += fan_in)
+        {
+            const std::size_t last = std::min(first + fan_in, runs.size());
+            if (last - first == 1U)
+            {
+                longer.push_back(runs[first]);
+                continue;
+            }
+
+            const std::vector<std::filesystem::path> group(runs.begin() + static_cast<std::ptrdiff_t>(first),
+                                                           runs.begin() + static_cast<std::ptrdiff_t>(last));
+            longer.push_back(spill.run(next_run++));
+            merge_run_files<T>(group, longer.back(), block_records, comp, proj);
+
+            for (const std::filesystem::path& run : group)
+            {
+                std::filesystem::remove(run);
+            }
+        }
+        runs = std::move(longer);
+    }
+
+    merge_run_files<T>(runs, output, block_records, comp, proj);
+}
+
+// blocks of text read and written at once by the integer filter
+constexpr std::size_t TEXT_BLOCK = 1U << 20U;
+
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+// appends every whitespace-separated integer of file to values; each block is cut
+// after its last blank, the unfinished token moves to the front of the next block.
+// Returns false on a token that is not an integer in range.
+static bool read_integers(std::FILE* file, std::vector<std::int64_t>& values)
+{
+    std::vector<char> buffer(TEXT_BLOCK);
+    std::size_t       kept = 0U;
+
+    for (;;)
+    {
+        const std::size_t wanted = buffer.size() - kept;
+        const std::size_t got    = std::fread(buffer.data() + kept, 1U, wanted, file);
+        const bool        last   = got < wanted;
+
+        const char* const begin = buffer.data();
+        const char* const end   = begin + kept + got;
+        const char*       limit = end;
+        if (!last)
+        {
+            while (limit != begin && !is_blank(limit[-1]))
+            {
+                --limit;
+            }
+            if (limit == begin)
+            {
+                return false; // one token fills the whole block
+            }
+        }
+
+        for (const char* p = begin; p != limit;)
+        {
+            if (is_blank(*p))
+            {
+                ++p;
+                continue;
+            }
+
+            std::int64_t value = 0;
+            const auto [next, ec] = std::from_chars(p, limit, value);
+            if (ec != std::errc{} || (next != limit && !is_blank(*next)))
+            {
+                return false;
+            }
+            values.push_back(value);
+            p = next;
+        }
+
+        if (last)
+        {
+            return std::ferror(file) == 0;
+        }
+
+        kept = static_cast<std::size_t>(end - limit);
+        std::memmove(buffer.data(), limit, kept);
+    }
+}
+
+// one integer per line
+static bool write_integers(std::FILE* file, std::span<const std::int64_t> values)
+{
+    // longest int64 plus the newline
+    constexpr std::size_t MAX_LINE = 21U;
+
+    std::vector<char> buffer(TEXT_BLOCK);
+    char* const       end = buffer.data() + buffer.size();
+    char*             out = buffer.data();
+
+    for (const std::int64_t value : values)
+    {
+        if (static_cast<std::size_t>(end - out) < MAX_LINE)
+        {
+            const std::size_t used = static_cast<std::size_t>(out - buffer.data());
+            if (std::fwrite(buffer.data(), 1U, used, file) != used)
+            {
+                return false;
+            }
+            out = buffer.data();
+        }
+        out    = std::to_chars(out, end, value).ptr;
+        *out++ = '\n';
+    }
+
+    const std::size_t used = static_cast<std::size_t>(out - buffer.data());
+    return std::fwrite(buffer.data(), 1U, used, file) == used && std::fflush(file) == 0;
+}
+
+// first i in [lo + 1, hi) with v[i] before v[i - 1], hi when there is none
+template <std::random_access_iterator It, class Compare, class Proj>
+static std::size_t first_descent(It v, std::size_t lo, std::size_t hi, Compare comp, Proj proj)
+{
+    if (hi - lo < 2U)
+    {
+        return hi;
+    }
+
+    if constexpr (std::contiguous_iterator<It> && simd_scannable_v<std::iter_value_t<It>, Compare, Proj>)
+    {
+        std::size_t pos = 0U;
+        if (simd_descent(std::to_address(v) + lo, hi - lo, pos))
+        {
+            return lo + pos;
+        }
+    }
+
+    for (std::size_t i = lo + 1U; i < hi; ++i)
+    {
+        if (cmp_less(v[i], v[i - 1U], comp, proj))
+        {
+            return i;
+        }
+    }
+    return hi;
+}
+
+// length of the sorted prefix: the position of the first element out of order,
+// size() when the whole range is sorted
+template <std::ranges::random_access_range R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires std::ranges::sized_range<R>
+static std::size_t sorted_until(const R& r, Compare comp = {}, Proj proj = {})
+{
+    return first_descent(std::ranges::begin(r), 0U, std::ranges::size(r), comp, proj);
+}
+
+// chunks of at least SCAN_CHUNK elements are checked on their own threads; every chunk
+// starts one element early, so the pairs across chunk boundaries are covered too.
+// policy.grain is the leaf size of sort and is not used here: a scan does so little
+// per element that a thread, started anew on every call, only pays off on far more
+template <std::ranges::random_access_range R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires std::ranges::sized_range<R>
+static std::size_t sorted_until(const parallel_policy& policy, const R& r, Compare comp = {}, Proj proj = {})
+{
+    const auto        v = std::ranges::begin(r);
+    const std::size_t n = std::ranges::size(r);
+
+    // about as long to scan as starting and joining a thread takes
+    constexpr std::size_t SCAN_CHUNK = 1U << 16U;
+
+    const unsigned    threads = (policy.threads != 0U) ? policy.threads : std::thread::hardware_concurrency();
+    const std::size_t chunks  = std::min<std::size_t>(std::max(threads, 1U), n / SCAN_CHUNK);
+
+    if (chunks <= 1U)
+    {
+        return first_descent(v, 0U, n, comp, proj);
+    }
+
+    std::vector<std::size_t> found(chunks, n);
+    std::vector<std::thread> helpers;
+    helpers.reserve(chunks - 1U);
+
+    const auto check = [&](std::size_t c)
+    {
+        const std::size_t lo = (c == 0U) ? 0U : n / chunks * c - 1U;
+        const std::size_t hi = (c + 1U == chunks) ? n : n / chunks * (c + 1U);
+        found[c] = first_descent(v, lo, hi, comp, proj);
+        if (found[c] == hi)
+        {
+            found[c] = n;
+        }
+    };
+
+    for (std::size_t c = 1U; c < chunks; ++c)
+    {
+        helpers.emplace_back(check, c);
+    }
+    check(0U);
+
+    for (std::thread& helper : helpers)
+    {
+        helper.join();
+    }
+    return *std::min_element(found.begin(), found.end());
+}
+
+template <std::ranges::random_access_range R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires std::ranges::sized_range<R>
+static bool is_sorted_vec(const R& r, Compare comp = {}, Proj proj = {})
+{
+    return sorted_until(r, comp, proj) == std::ranges::size(r);
+}
+
+template <std::ranges::random_access_range R,
+          class Compare = std::less<>,
+          class Proj    = std::identity>
+    requires std::ranges::sized_range<R>
+static bool is_sorted_vec(const parallel_policy& policy, const R& r, Compare comp = {}, Proj proj = {})
+{
+    return sorted_until(policy, r, comp, proj) == std::ranges::size(r);
+}
+
+
+struct Record // example
+{
+    int         id{};
+    std::string name{};
+    double      score{};
+};
+
+// counts copies, moves are free
+struct CopyCounted
+{
+    int         key{};
+    std::string text{};
+
+    static inline std::size_t copies = 0U;
+
+    CopyCounted() = default;
+    CopyCounted(int k, std::string t) : key(k), text(std::move(t)) {}
+    CopyCounted(const CopyCounted& other) : key(other.key), text(other.text) { ++copies; }
+    CopyCounted(CopyCounted&&) noexcept = default;
+    CopyCounted& operator=(const CopyCounted& other)
+    {
+        key  = other.key;
+        text = other.text;
+        ++copies;
+        return *this;
+    }
+    CopyCounted& operator=(CopyCounted&&) noexcept = default;
+};
+
+#ifdef SORT_BENCH
+
+// Benchmark build (Code::Blocks target "Bench", -DSORT_BENCH): CSV on stdout,
+// one row per algorithm, input distribution and size.
+//   04-01 [max_size [max_records]]
+// int inputs run at sizes 1e3, 1e4, ... up to max_size (default 1e8, about 1 GB with the
+// per-rep copy and scratch), the records_by_name rows only up to max_records (default 1e6):
+// a Record with its heap string is ~100 bytes, so 1e8 of them would need ~20 GB.
+// Comparisons and element moves per element are counted in a second, instrumented
+// run for n <= 1e6 (a swap is three moves); the columns stay empty for sort, whose
+// radix and string engines do not go through the comparator, and for larger n.
+
+enum class bench_input
+{
+    random,
+    sorted,
+    reversed,
+    sawtooth,
+    few_unique,
+    organ_pipe
+};
+
+constexpr std::array<bench_input, 6U> BENCH_INPUTS{
+    bench_input::random, bench_input::sorted, bench_input::reversed,
+    bench_input::sawtooth, bench_input::few_unique, bench_input::organ_pipe};
+
+inline const char* bench_input_name(bench_input kind)
+{
+    switch (kind)
+    {
+    case bench_input::random:     return "random";
+    case bench_input::sorted:     return "sorted";
+    case bench_input::reversed:   return "reversed";
+    case bench_input::sawtooth:   return "sawtooth";
+    case bench_input::few_unique: return "few_unique";
+    case bench_input::organ_pipe: return "organ_pipe";
+    }
+    return "?";
+}
+
+static std::vector<int> make_bench_input(bench_input kind, std::size_t n, std::mt19937& gen)
+{
+    std::vector<int> v(n);
+    for (std::size_t i = 0U; i < n; ++i)
+    {
+        switch (kind)
+        {
+        case bench_input::random:     v[i] = static_cast<int>(gen());                        break;
+        case bench_input::sorted:     v[i] = static_cast<int>(i);                            break;
+        case bench_input::reversed:   v[i] = static_cast<int>(n - i);                        break;
+        case bench_input::sawtooth:   v[i] = static_cast<int>((i * 37U) % 113U);             break;
+        case bench_input::few_unique: v[i] = static_cast<int>(gen() % 16U);                  break;
+        case bench_input::organ_pipe: v[i] = static_cast<int>(i < n / 2U ? i : n - i);       break;
+        }
+    }
+    return v;
+}
+
+static std::vector<Record> make_bench_records(std::size_t n, std::mt19937& gen)
+{
+    std::vector<Record> v(n);
+    for (std::size_t i = 0U; i < n; ++i)
+    {
+        const unsigned id = static_cast<unsigned>(gen() % (n + 1U));
+        v[i] = Record{static_cast<int>(i), "https://example.com/users/" + std::to_string(id), static_cast<double>(id)};
+    }
+    return v;
+}
+
+// element wrapper for the instrumented run
+template <class T>
+struct move_counted
+{
+    T value{};
+
+    static inline std::size_t moves = 0U;
+
+    move_counted() = default;
+    explicit move_counted(T v) : value(std::move(v)) {}
+    move_counted(const move_counted& other) : value(other.value) { ++moves; }
+    move_counted(move_counted&& other) noexcept : value(std::move(other.value)) { ++moves; }
+    move_counted& operator=(const move_counted& other)
+    {
+        value = other.value;
+        ++moves;
+        return *this;
+    }
+    move_counted& operator=(move_counted&& other) noexcept
+    {
+        value = std::move(other.value);
+        ++moves;
+        return *this;
+    }
+};
+
+constexpr std::array<const char*, 6U> BENCH_ALGORITHMS{
+    "sort", "sort_hoare", "sort_block", "stable_sort", "std::sort", "std::stable_sort"};
+
+template <class T, class Compare, class Proj>
+static void run_bench_algorithm(std::size_t which, std::vector<T>& v, Compare comp, Proj proj)
+{
+    const auto less = [&](const T& x, const T& y)
+    {
+        return cmp_less(x, y, comp, proj);
+    };
+
+    switch (which)
+    {
+    case 0U: sort(v, comp, proj);                                break;
+    case 1U: sort(hoare_partition_policy{}, v, comp, proj);      break;
+    case 2U: sort(block_partition_policy{}, v, comp, proj);      break;
+    case 3U: stable_sort(v, comp, proj);                         break;
+    case 4U: std::sort(v.begin(), v.end(), less);                break;
+    case 5U: std::stable_sort(v.begin(), v.end(), less);         break;
+    default:                                                     break;
+    }
+}
+
+template <class T, class Proj>
+static void bench_row(const char* input, std::size_t which, const std::vector<T>& data, Proj proj)
+{
+    using clock = std::chrono::steady_clock;
+
+    constexpr std::size_t COUNT_LIMIT = 1'000'000U;
+
+    const std::size_t n    = data.size();
+    const std::size_t reps = std::clamp<std::size_t>(1'000'000U / std::max<std::size_t>(n, 1U), 1U, 20U);
+
+    double best = std::numeric_limits<double>::max();
+    for (std::size_t rep = 0U; rep < reps; ++rep)
+    {
+        std::vector<T> v = data;
+
+        const clock::time_point start = clock::now();
+        run_bench_algorithm(which, v, std::less<>{}, proj);
+        best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+
+        if (!is_sorted_vec(v, std::less<>{}, proj))
+        {
+            std::cerr << BENCH_ALGORITHMS[which] << " failed on " << input << ' ' << n << '\n';
+        }
+    }
+
+    std::cout << BENCH_ALGORITHMS[which] << ',' << input << ',' << n << ',' << best << ','
+              << best * 1e9 / static_cast<double>(n) << ',';
+
+    if (which != 0U && n <= COUNT_LIMIT)
+    {
+        std::vector<move_counted<T>> v;
+        v.reserve(n);
+        for (const T& x : data)
+        {
+            v.emplace_back(x);
+        }
+
+        std::size_t comparisons = 0U;
+        const auto counting_less = [&comparisons](const auto& x, const auto& y)
+        {
+            ++comparisons;
+            return x < y;
+        };
+        const auto counted_proj = [&proj](const move_counted<T>& x) -> decltype(auto)
+        {
+            return std::invoke(proj, x.value);
+        };
+
+        move_counted<T>::moves = 0U;
+        run_bench_algorithm(which, v, counting_less, counted_proj);
+
+        std::cout << static_cast<double>(comparisons) / static_cast<double>(n) << ','
+                  << static_cast<double>(move_counted<T>::moves) / static_cast<double>(n);
+    }
+    else
+    {
+        std::cout << ',';
+    }
+    std::cout << std::endl;
+}
+
+static int run_benchmarks(int argc, char* argv[])
+{
+    std::size_t max_size    = 100'000'000U;
+    std::size_t max_records = 1'000'000U;
+    if (argc > 1)
+    {
+        max_size = static_cast<std::size_t>(std::stod(argv[1]));
+    }
+    if (argc > 2)
+    {
+        max_records = static_cast<std::size_t>(std::stod(argv[2]));
+    }
+
+    std::mt19937 gen(2024U);
+
+    std::cout << "algorithm,input,n,seconds,ns_per_element,comparisons_per_element,moves_per_element\n";
+
+    for (std::size_t n = 1'000U; n <= max_size; n *= 10U)
+    {
+        for (bench_input kind : BENCH_INPUTS)
+        {
+            const std::vector<int> data = make_bench_input(kind, n, gen);
+            for (std::size_t which = 0U; which < BENCH_ALGORITHMS.size(); ++which)
+            {
+                bench_row(bench_input_name(kind), which, data, std::identity{});
+            }
+        }
+
+        if (n <= max_records)
+        {
+            const std::vector<Record> records = make_bench_records(n, gen);
+            for (std::size_t which = 0U; which < BENCH_ALGORITHMS.size(); ++which)
+            {
+                bench_row("records_by_name", which, records, &Record::name);
+            }
+        }
+    }
+    return 0;
+}
+
+#endif
+
+static void run_self_test()
+{
+    std::size_t n1 = 1'000U;
+    std::vector<int> v1(n1);
+    for (std::size_t i = 0U; i < n1; ++i)
+        v1[i] = static_cast<int>(n1 - i);
+
+    // reversed input is detected as one descending run: n - 1 comparisons and a reverse
+    std::size_t comparisons = 0U;
+    const auto counting_less = [&comparisons](int lhs, int rhs)
+    {
+        ++comparisons;
+        return lhs < rhs;
+    };
+    sort(v1, counting_less);
+    assert(is_sorted_vec(v1));
+    assert(comparisons < n1);
+
+    // a few long runs are merged
+    std::rotate(v1.begin(), v1.begin() + 300, v1.end());
+    std::reverse(v1.begin() + 500, v1.end());
+    sort(v1);
+    assert(is_sorted_vec(v1));
+
+    std::size_t n2 = 2'001U;
+    std::vector<int> v2(n2);
+    for (std::size_t i = 0U; i < n2; ++i)
+        v2[i] = static_cast<int>((i * 37U) % 113U);
+
+    sort(v2);
+    assert(is_sorted_vec(v2));
+
+    // few distinct keys: each run of equal keys is split off once
+    std::vector<int> grades(100'000U);
+    for (std::size_t i = 0U; i < grades.size(); ++i)
+        grades[i] = static_cast<int>((i * 7'919U) % 5U);
+    comparisons = 0U;
+    sort(hoare_partition_policy{}, grades, counting_less);
+    assert(is_sorted_vec(grades));
+    assert(comparisons < 10U * grades.size());
+
+    std::vector<std::string> words{"pear", "apple", "banana", "banana", "cherry", "apricot", "fig", "date"};
+    sort(words);
+    assert(is_sorted_vec(words));
+
+    std::vector<Record> people{
+        {3, "Ann", 87.5},
+        {1, "Bob", 91.2},
+        {2, "Eve", 74.1},
+        {4, "Zed", 87.5},
+    };
+
+    sort(people, std::less<>{}, [](const Record& r) { return r.score; });
+    assert(is_sorted_vec(people, std::less<>{}, [](const Record& r) { return r.score; }));
+
+    std::mt19937 gen(2024U);
+    std::uniform_int_distribution<int> dist(-1'000'000, 1'000'000);
+
+    std::vector<int> big(200'000U);
+    for (int& x : big) x = dist(gen);
+    std::vector<int> expected = big;
+    std::sort(expected.begin(), expected.end());
+
+    sort(parallel_policy{1'024U, 4U}, big);
+    assert(big == expected);
+
+    sort(parallel_policy{64U, 3U}, people, std::less<>{}, [](const Record& r) { return r.score; });
+    assert(is_sorted_vec(people, std::less<>{}, [](const Record& r) { return r.score; }));
+
+    // few distinct keys pile up in the buckets right of equal splitters
+    std::vector<int> clumped(100'000U);
+    for (int& x : clumped) x = dist(gen) % 4;
+    std::vector<int> clumped_expected = clumped;
+    std::sort(clumped_expected.begin(), clumped_expected.end(), std::greater<>{});
+    sort(parallel_policy{512U, 3U}, clumped, std::greater<>{});
+    assert(clumped == clumped_expected);
+
+    // radix engine: signed ints, doubles with both signs, keys through a projection
+    std::vector<int> radixed = expected;
+    std::shuffle(radixed.begin(), radixed.end(), gen);
+    sort(radixed);
+    assert(radixed == expected);
+
+    std::uniform_real_distribution<double> real_dist(-1e6, 1e6);
+    std::vector<double> reals(50'000U);
+    for (double& x : reals) x = real_dist(gen);
+    reals[0] = -0.0;
+    reals[1] = 0.0;
+    sort(reals);
+    assert(is_sorted_vec(reals));
+
+    std::vector<Record> scored(3'000U);
+    for (std::size_t i = 0U; i < scored.size(); ++i)
+        scored[i] = Record{static_cast<int>(i), "r" + std::to_string(i), real_dist(gen)};
+
+    radix_buffer<Record, double> record_buffer;
+    radix_sort(std::span(scored), record_buffer, &Record::score);
+    assert(is_sorted_vec(scored, std::less<>{}, &Record::score));
+
+    // Record is too heavy to follow every digit pass: the radix engine sorts indices
+    // and moves each record once, still stable on the coarse integer scores
+    for (Record& r : scored) r.score = static_cast<double>(static_cast<int>(r.score / 1e5));
+    std::shuffle(scored.begin(), scored.end(), gen);
+    std::vector<Record> scored_stable = scored;
+    std::stable_sort(scored_stable.begin(), scored_stable.end(),
+                     [](const Record& x, const Record& y) { return x.score < y.score; });
+    sort(scored, std::less<>{}, &Record::score);
+    for (std::size_t i = 0U; i < scored.size(); ++i) assert(scored[i].id == scored_stable[i].id);
+
+    // one caller-owned buffer across arrays of growing size
+    radix_buffer<int, int> int_buffer;
+    for (std::size_t n : {600U, 5'000U, 2'000U})
+    {
+        std::vector<int> batch(n);
+        for (int& x : batch) x = dist(gen);
+        std::vector<int> batch_expected = batch;
+        std::sort(batch_expected.begin(), batch_expected.end());
+        sort(batch, int_buffer);
+        assert(batch == batch_expected);
+    }
+    assert(int_buffer.bits.capacity() >= 5'000U);
+
+    // block partitioning on ints, doubles and a projected string key
+    std::vector<int> blocked = expected;
+    std::shuffle(blocked.begin(), blocked.end(), gen);
+    sort(block_partition_policy{}, blocked);
+    assert(blocked == expected);
+
+    std::vector<double> few(10'000U);
+    for (double& x : few) x = static_cast<double>(gen() % 7U) - 3.0;
+    sort(block_partition_policy{}, few);
+    assert(is_sorted_vec(few));
+
+    sort(block_partition_policy{}, scored, std::greater<>{}, &Record::name);
+    assert(is_sorted_vec(scored, std::greater<>{}, &Record::name));
+
+    // cached keys: the projection runs exactly once per element
+    std::size_t projections = 0U;
+    const auto label = [&projections](const Record& r)
+    {
+        ++projections;
+        return r.name + '#' + std::to_string(r.id);
+    };
+    sort_cached(scored, std::less<>{}, label);
+    assert(projections == scored.size());
+    assert(is_sorted_vec(scored, std::less<>{}, [](const Record& r) { return r.name + '#' + std::to_string(r.id); }));
+
+    sort_cached(scored, std::less<>{}, &Record::score);
+    assert(is_sorted_vec(scored, std::less<>{}, &Record::score));
+
+    // string keys with long shared prefixes, embedded zero bytes and duplicates
+    std::vector<std::string> urls;
+    for (std::size_t i = 0U; i < 2'000U; ++i)
+    {
+        urls.push_back("https://example.com/static/assets/" + std::to_string(gen() % 500U));
+        if (i % 97U == 0U) urls.push_back(std::string("https://example.com/static\0x", 28U));
+        if (i % 89U == 0U) urls.push_back("https://example.com/static");
+    }
+    std::vector<std::string> url_expected = urls;
+    std::sort(url_expected.begin(), url_expected.end());
+    sort(urls);
+    assert(urls == url_expected);
+
+    string_sort(std::span(words));
+    assert(is_sorted_vec(words));
+
+    string_sort(std::span(scored), [](const Record& r) { return r.name + '#'; });
+    assert(is_sorted_vec(scored, std::less<>{}, &Record::name));
+
+    // stable: equal scores keep their id order, the scratch is reused across sorts
+    std::vector<Record> ranked;
+    for (std::size_t i = 0U; i < 5'000U; ++i)
+        ranked.push_back(Record{static_cast<int>(i), "r", static_cast<double>(gen() % 10U)});
+
+    std::vector<Record> scratch;
+    stable_sort(ranked, scratch, std::less<>{}, &Record::score);
+    for (std::size_t i = 1U; i < ranked.size(); ++i)
+        assert(ranked[i - 1U].score < ranked[i].score ||
+               (ranked[i - 1U].score == ranked[i].score && ranked[i - 1U].id < ranked[i].id));
+
+    stable_sort(ranked, scratch, std::greater<>{}, &Record::id);
+    const std::size_t scratch_capacity = scratch.capacity();
+    stable_sort(ranked, scratch, std::less<>{}, &Record::score);
+    stable_sort(ranked, scratch, std::greater<>{}, &Record::id);
+    assert(scratch.capacity() == scratch_capacity);
+
+    std::vector<int> merged = expected;
+    std::reverse(merged.begin(), merged.begin() + 70'000);
+    std::shuffle(merged.begin() + 150'000, merged.end(), gen);
+    stable_sort(merged);
+    assert(merged == expected);
+
+    // external sort of fixed-width rows: 50'000 with a 64 KiB budget make 13 runs merged
+    // two at a time, 300'000 with 1 MiB make 5 runs merged at once, 20'000 with 1600
+    // bytes make 200 runs of 100 rows merged in eight passes
+    {
+        struct fixed_row
+        {
+            std::uint32_t key;
+            std::uint32_t payload;
+        };
+
+        // the test files get a private directory too, removed with whatever is left in it
+        const spill_area              scratch(std::filesystem::temp_directory_path());
+        const std::filesystem::path   unsorted  = scratch.dir() / "external.in";
+        const std::filesystem::path   sorted    = scratch.dir() / "external.out";
+        const std::filesystem::path   spill_dir = scratch.dir() / "spill";
+        std::filesystem::create_directory(spill_dir);
+
+        assert(merge_fan_in(1600U) == 2U && merge_fan_in(64U * 1024U) == 2U);
+        assert(merge_fan_in(1024U * 1024U) <= 14U);
+
+        std::vector<fixed_row> rows;
+        for (const auto& [count, budget] : {std::pair<std::size_t, std::size_t>{50'000U, 64U * 1024U},
+                                           std::pair<std::size_t, std::size_t>{300'000U, 1024U * 1024U},
+                                           std::pair<std::size_t, std::size_t>{20'000U, 1600U}})
+        {
+            rows.resize(count);
+            for (std::size_t i = 0U; i < rows.size(); ++i)
+                rows[i] = fixed_row{static_cast<std::uint32_t>(gen() % 1'000U), static_cast<std::uint32_t>(i)};
+            {
+                file_handle file = open_file(unsorted, "wb");
+                write_block(file.get(), rows);
+            }
+
+            external_sort<fixed_row>(unsorted, sorted, budget, spill_dir, std::less<>{}, &fixed_row::key);
+            assert(std::filesystem::is_empty(spill_dir));
+
+            std::vector<fixed_row> back;
+            back.reserve(rows.size() + 1U);
+            {
+                file_handle file = open_file(sorted, "rb");
+                read_block(file.get(), back);
+            }
+            assert(back.size() == rows.size());
+            assert(is_sorted_vec(back, std::less<>{}, &fixed_row::key));
+
+            std::vector<bool> seen(rows.size(), false);
+            for (const fixed_row& row : back)
+            {
+                assert(!seen[row.payload] && rows[row.payload].key == row.key);
+                seen[row.payload] = true;
+            }
+        }
+
+        // failures throw instead of truncating, and leave no run files behind
+        const auto fails = [&](const std::filesystem::path& out)
+        {
+            try
+            {
+                external_sort<fixed_row>(unsorted, out, 64U * 1024U, spill_dir, std::less<>{}, &fixed_row::key);
+            }
+            catch (const std::exception&)
+            {
+                return std::filesystem::is_empty(spill_dir);
+            }
+            return false;
+        };
+
+        const bool missing_dir_fails = fails(spill_dir / "missing" / "sorted.out");
+        assert(missing_dir_fails);
+
+        {
+            file_handle file = open_file(unsorted, "ab");
+            std::fputc('x', file.get());
+        }
+        const bool torn_record_fails = fails(sorted);
+        assert(torn_record_fails);
+    }
+
+    // selection: median, partial_sort and top-k, streamed or not
+    std::vector<int> picked = expected;
+    std::shuffle(picked.begin(), picked.end(), gen);
+    nth_element(picked, picked.size() / 2U);
+    assert(picked[picked.size() / 2U] == expected[expected.size() / 2U]);
+
+    std::shuffle(picked.begin(), picked.end(), gen);
+    partial_sort(picked, 1'000U);
+    assert(std::equal(picked.begin(), picked.begin() + 1'000, expected.begin()));
+
+    const std::vector<Record> best = top_k(scored, 10U, std::greater<>{}, &Record::score);
+    top_k_heap<Record, std::greater<>, double Record::*> best_stream(10U, std::greater<>{}, &Record::score);
+    for (const Record& r : scored) best_stream.push(r);
+    const std::vector<Record> streamed = best_stream.take_sorted();
+    assert(best.size() == 10U && streamed.size() == 10U);
+    for (std::size_t i = 0U; i < best.size(); ++i)
+        assert(best[i].score == streamed[i].score);
+    assert(is_sorted_vec(best, std::greater<>{}, &Record::score));
+
+    const std::vector<Record> best_owned = top_k(std::vector<Record>(scored), 10U, std::greater<>{}, &Record::score);
+    assert(best_owned.size() == 10U);
+    for (std::size_t i = 0U; i < best.size(); ++i)
+        assert(best_owned[i].score == best[i].score);
+
+    // a single-pass stream of unknown length
+    std::istringstream numbers("42 -7 19 3 88 -7 0 61 5");
+    assert((top_k(std::views::istream<int>(numbers), 4U) == std::vector<int>{-7, -7, 0, 3}));
+    assert(top_k(picked | std::views::filter([](int x) { return x % 2 == 0; }), picked.size()).size() ==
+           static_cast<std::size_t>(std::ranges::count_if(picked, [](int x) { return x % 2 == 0; })));
+
+    // index sort moves every record at most once; no path copies elements any more
+    std::vector<CopyCounted> heavy;
+    for (std::size_t i = 0U; i < 3'000U; ++i)
+        heavy.emplace_back(static_cast<int>(gen() % 100U), std::string(40U, static_cast<char>('a' + i % 26U)));
+
+    sort_indexed(heavy, std::less<>{}, &CopyCounted::text);
+    assert(is_sorted_vec(heavy, std::less<>{}, &CopyCounted::text));
+    sort_indexed(heavy, std::less<>{}, &CopyCounted::key);
+    assert(is_sorted_vec(heavy, std::less<>{}, &CopyCounted::key));
+    sort(hoare_partition_policy{}, heavy, std::greater<>{}, &CopyCounted::text);
+    assert(is_sorted_vec(heavy, std::greater<>{}, &CopyCounted::text));
+    sort(block_partition_policy{}, heavy, std::less<>{}, &CopyCounted::key);
+    assert(is_sorted_vec(heavy, std::less<>{}, &CopyCounted::key));
+    assert(CopyCounted::copies == 0U);
+
+    // sorting networks: every block size against std::sort, on every ISA this CPU has
+    {
+        std::vector<int>    ni(32U);
+        std::vector<float>  nf(32U);
+        std::vector<double> nd(32U);
+        for (std::size_t n = 0U; n <= 32U; ++n)
+        {
+            for (std::size_t i = 0U; i < n; ++i)
+            {
+                ni[i] = dist(gen) % 50;
+                nf[i] = static_cast<float>(ni[i]) * 0.5F;
+                nd[i] = real_dist(gen);
+            }
+            nf[0] = -0.0F;
+
+            std::vector<int>    ei(ni.begin(), ni.begin() + static_cast<std::ptrdiff_t>(n));
+            std::vector<float>  ef(nf.begin(), nf.begin() + static_cast<std::ptrdiff_t>(n));
+            std::vector<double> ed(nd.begin(), nd.begin() + static_cast<std::ptrdiff_t>(n));
+            std::sort(ei.begin(), ei.end());
+            std::sort(ef.begin(), ef.end());
+            std::sort(ed.begin(), ed.end());
+
+            std::vector<int>    ri(ni.begin(), ni.begin() + static_cast<std::ptrdiff_t>(n));
+            std::vector<float>  rf(nf.begin(), nf.begin() + static_cast<std::ptrdiff_t>(n));
+            std::vector<double> rd(nd.begin(), nd.begin() + static_cast<std::ptrdiff_t>(n));
+            sort(ri);
+            sort(rf);
+            sort(rd);
+            assert(ri == ei && rf == ef && rd == ed);
+
+#if SORT_X86_SIMD
+            if (cpu_simd_level() != simd_level::none)
+            {
+                ri.assign(ni.begin(), ni.begin() + static_cast<std::ptrdiff_t>(n));
+                rf.assign(nf.begin(), nf.begin() + static_cast<std::ptrdiff_t>(n));
+                rd.assign(nd.begin(), nd.begin() + static_cast<std::ptrdiff_t>(n));
+                network_sort_sse41(ri.data(), n);
+                network_sort_sse41(rf.data(), n);
+                network_sort_sse41(rd.data(), n);
+                assert(ri == ei && rf == ef && rd == ed);
+            }
+#endif
+        }
+    }
+
+    // a zero depth budget goes straight to the heapsort fallback
+    std::vector<int> heaped = expected;
+    std::shuffle(heaped.begin(), heaped.end(), gen);
+    quick_split(std::span(heaped), 0U, heaped.size(), 0U, std::less<>{}, std::identity{});
+    assert(heaped == expected);
+
+    // contiguous buffers other than std::vector sort in place
+    std::array<int, 6U> fixed{5, -1, 4, 4, 0, 9};
+    sort(fixed);
+    assert(is_sorted_vec(fixed));
+
+    int plain[] = {3, 1, 2, 8, 7};
+    stable_sort(plain, std::greater<>{});
+    assert(is_sorted_vec(plain, std::greater<>{}));
+
+    const std::unique_ptr<int[]> arena(new int[expected.size()]);
+    std::reverse_copy(expected.begin(), expected.end(), arena.get());
+    const std::span<int> slice(arena.get(), expected.size());
+    sort(parallel_policy{1U << 12U, 2U}, slice);
+    assert(std::equal(slice.begin(), slice.end(), expected.begin()));
+
+    // iterator pairs through subrange: only the middle is touched
+    std::vector<int> window = v2;
+    std::shuffle(window.begin(), window.end(), gen);
+    const std::vector<int> outside = window;
+    sort(std::ranges::subrange(window.begin() + 100, window.end() - 100), std::less<>{});
+    assert(is_sorted_vec(std::ranges::subrange(window.begin() + 100, window.end() - 100)));
+    assert(std::equal(window.begin(), window.begin() + 100, outside.begin()));
+    assert(std::equal(window.end() - 100, window.end(), outside.end() - 100));
+
+    nth_element(slice.first(1'000U), 10U, std::greater<>{});
+    partial_sort(slice.last(1'000U), 10U);
+    assert(is_sorted_vec(slice.last(1'000U).first(10U)));
+
+    // columnar rows by score, then name, then id, against the row-wise stable sort
+    {
+        std::vector<Record> rows = scored;
+        for (std::size_t i = 0U; i < rows.size(); ++i)
+        {
+            rows[i].id    = static_cast<int>(i);
+            rows[i].score = std::floor(rows[i].score / 1e5);
+            rows[i].name  = rows[i].name.substr(0U, 2U);
+        }
+
+        std::vector<int>         ids;
+        std::vector<std::string> names;
+        std::vector<double>      scores;
+        for (const Record& r : rows)
+        {
+            ids.push_back(r.id);
+            names.push_back(r.name);
+            scores.push_back(r.score);
+        }
+
+        stable_sort(rows, [](const Record& x, const Record& y)
+        {
+            return std::tie(x.score, x.name, x.id) < std::tie(y.score, y.name, y.id);
+        });
+        std::reverse(ids.begin(), ids.end());
+        std::reverse(names.begin(), names.end());
+        std::reverse(scores.begin(), scores.end());
+        sort_columns<2, 1, 0>(std::tuple{std::span(ids), std::span(names), std::span(scores)});
+
+        for (std::size_t i = 0U; i < rows.size(); ++i)
+        {
+            assert(ids[i] == rows[i].id && names[i] == rows[i].name && scores[i] == rows[i].score);
+        }
+
+        // columns passed by reference, keys in another order
+        sort_columns<1, 2>(std::tie(ids, names, scores));
+        for (std::size_t i = 1U; i < names.size(); ++i)
+        {
+            assert(std::tie(names[i - 1U], scores[i - 1U]) <= std::tie(names[i], scores[i]));
+        }
+    }
+
+    // order checks report the first element out of place, serial and chunked alike
+    std::vector<double> checked(expected.begin(), expected.end());
+    assert(sorted_until(checked) == checked.size());
+    assert(is_sorted_vec(parallel_policy{1U << 12U, 4U}, checked));
+    checked[123'457U] = -1.0;
+    assert(sorted_until(checked) == 123'457U);
+    assert(sorted_until(checked, std::less<>{}, [](double x) { return x; }) == 123'457U);
+    assert(sorted_until(parallel_policy{1U << 12U, 4U}, checked) == 123'457U);
+    checked[123'457U] = checked[123'456U];
+
+    // 200'000 elements make three chunks whatever the grain; the first one out of
+    // order sits right at the second chunk's start
+    const std::size_t edge = checked.size() / 3U;
+    checked[edge] = checked[edge - 1U] - 1.0;
+    assert(sorted_until(parallel_policy{1U << 12U, 4U}, checked) == edge);
+    assert(sorted_until(parallel_policy{1U << 20U, 4U}, checked) == edge);
+
+    std::cout << "All tests passed\n";
+}
+
+// sort filter:
+//   04-01 [file]        whitespace-separated integers from file (stdin without one),
+//                       sorted to stdout, one per line
+//   04-01 --self-test   runs the assertions above
+static int run_filter(int argc, char* argv[])
+{
+    std::vector<std::int64_t> values;
+
+    try
+    {
+        bool parsed = false;
+        if (argc > 1)
+        {
+            const file_handle input = open_file(argv[1], "rb");
+            parsed = read_integers(input.get(), values);
+        }
+        else
+        {
+            parsed = read_integers(stdin, values);
+        }
+
+        if (!parsed)
+        {
+            std::cerr << "Invalid input\n";
+            return 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    sort(values);
+
+    if (!write_integers(stdout, values))
+    {
+        std::cerr << "Write error\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef SORT_BENCH
+    return run_benchmarks(argc, argv);
+#endif
+
+    if (argc > 1 && std::string_view(argv[1]) == "--self-test")
+    {
+        run_self_test();
+        return 0;
+    }
 
-    std::cout << "Sorted:\n";
-    for (auto v : user) std::cout << v << ' ';
-    std::cout << '\n';
+    return run_filter(argc, argv);
 }
@@ -0,0 +1,82 @@
+#!/bin/sh
+# Compile-time cost of pack_max: the old recursive form against the fold in main.cpp.
+#
+#   ./compile_bench.sh [compiler]        (default g++)
+#
+# For packs of 10, 100 and 1000 doubles prints CSV with
+#   depth_ok         whether the pack compiles with the default -ftemplate-depth
+#   frontend_s       wall time of -fsyntax-only (with the depth raised when needed)
+#   instantiations   pack_max functions in the -O0 object file (nm)
+
+CXX=${1:-g++}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+cat > "$dir/old.hpp" <<'EOF'
+#include <type_traits>
+
+double pack_max(double value)
+{
+    return value;
+}
+
+template <typename... Rest>
+double pack_max(double first, Rest... rest)
+{
+    static_assert((std::is_same_v<Rest, double> && ...),
+                  "All arguments must be of type double");
+
+    const double tail_max = pack_max(rest...);
+
+    return (first > tail_max) ? first : tail_max;
+}
+EOF
+
+# same as pack_max in main.cpp
+cat > "$dir/new.hpp" <<'EOF'
+#include <type_traits>
+
+template <typename... Rest>
+double pack_max(double first, Rest... rest)
+{
+    static_assert((std::is_same_v<Rest, double> && ...),
+                  "All arguments must be of type double");
+
+    double result = first;
+    ((result = (rest > result) ? rest : result), ...);
+
+    return result;
+}
+EOF
+
+now()
+{
+    date +%s.%N
+}
+
+echo "form,args,depth_ok,frontend_s,instantiations"
+
+for n in 10 100 1000; do
+    args=$(seq -s ', ' 1 "$n" | sed 's/\([0-9][0-9]*\)/\1.0/g')
+
+    for form in old new; do
+        src="$dir/${form}_$n.cpp"
+        printf '#include "%s.hpp"\ndouble probe() { return pack_max(%s); }\n' "$form" "$args" > "$src"
+
+        if "$CXX" -std=c++20 -fsyntax-only "$src" 2>/dev/null; then
+            depth_ok=yes
+        else
+            depth_ok=no
+        fi
+
+        start=$(now)
+        "$CXX" -std=c++20 -ftemplate-depth=$((n + 100)) -fsyntax-only "$src" || exit 1
+        end=$(now)
+
+        "$CXX" -std=c++20 -ftemplate-depth=$((n + 100)) -O0 -c "$src" -o "$dir/${form}_$n.o" || exit 1
+        count=$(nm -C "$dir/${form}_$n.o" | grep -c ' pack_max')
+
+        echo "$form,$n,$depth_ok,$(echo "$start $end" | awk '{ printf "%.3f", $2 - $1 }'),$count"
+    done
+done
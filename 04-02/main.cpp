@@ -1,52 +1,136 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 bool almost_equal(double lhs, double rhs, double epsilon = 1e-9)
 {
     return std::abs(lhs - rhs) <= epsilon;
 }
 
+// How pack_sum and pack_mean add, picked by their first template argument:
+// fold_sum      the right fold for packs, the fastest vector order for ranges
+// pairwise_sum  a balanced tree, O(log n) error growth and independent additions
+// kahan_sum     compensated, the rounding error of each addition is carried along
+// neumaier_sum  compensated, also exact when a term is larger than the running sum
+struct fold_sum {};
+struct pairwise_sum {};
+struct kahan_sum {};
+struct neumaier_sum {};
+
+template <typename Policy>
+inline constexpr bool summation_policy_v = std::is_same_v<Policy, fold_sum> ||
+                                           std::is_same_v<Policy, pairwise_sum> ||
+                                           std::is_same_v<Policy, kahan_sum> ||
+                                           std::is_same_v<Policy, neumaier_sum>;
+
+template <typename Policy>
+inline constexpr bool compensated_policy_v = std::is_same_v<Policy, kahan_sum> ||
+                                             std::is_same_v<Policy, neumaier_sum>;
 
-double pack_max(double value)
+// running sum with an error term: Kahan subtracts the error of the previous addition
+// from the next term, Neumaier collects the errors and adds them at the end
+template <bool NEUMAIER>
+struct compensated_sum
 {
-    return value;
-}
+    double sum   = 0.0;
+    double carry = 0.0;
+
+    constexpr void add(double value)
+    {
+        if constexpr (NEUMAIER)
+        {
+            const double t = sum + value;
+            carry += (std::abs(sum) >= std::abs(value)) ? (sum - t) + value : (value - t) + sum;
+            sum    = t;
+        }
+        else
+        {
+            const double y = value - carry;
+            const double t = sum + y;
+            carry = (t - sum) - y;
+            sum   = t;
+        }
+    }
+
+    constexpr double total() const
+    {
+        return NEUMAIER ? sum + carry : sum;
+    }
+};
+
 
+// one fold over the pack instead of one instantiation per argument: a pack of any
+// size is a single function, far below the template depth limit
 template <typename... Rest> // variadic template function can take any number of double-type args
 double pack_max(double first, Rest... rest)
 {
     static_assert((std::is_same_v<Rest, double> && ...),
                   "All arguments must be of type double");
 
-    const double tail_max = pack_max(rest...);
+    double result = first;
+    ((result = (rest > result) ? rest : result), ...);
 
-    return (first > tail_max) ? first : tail_max;
+    return result;
 }
 
 
-// base case for recursion for minimum
-double pack_min(double value)
-{
-    return value;
-}
-
-// recursive case for minimum
 template <typename... Rest>
 double pack_min(double first, Rest... rest)
 {
     static_assert((std::is_same_v<Rest, double> && ...),
                   "all arguments must be of type double");
 
-    // recursively compute minimum of the tail
-    const double tail_min = pack_min(rest...);
+    double result = first;
+    ((result = (rest < result) ? rest : result), ...);
+
+    return result;
+}
+
 
-    return (first < tail_min) ? first : tail_min;
+// terms[Offset, Offset + sizeof...(I)) added as the sum of its two halves, each split
+// the same way down to single terms: the whole tree is instantiated at compile time,
+// no loop is left and the two halves of every node are independent of each other
+template <std::size_t Offset, std::size_t... I, std::size_t N>
+constexpr double pairwise_pack(const std::array<double, N>& terms, std::index_sequence<I...>)
+{
+    constexpr std::size_t count = sizeof...(I);
+
+    if constexpr (count == 1)
+    {
+        return terms[Offset];
+    }
+    else
+    {
+        constexpr std::size_t half = count / 2;
+        return pairwise_pack<Offset>(terms, std::make_index_sequence<half>{}) +
+               pairwise_pack<Offset + half>(terms, std::make_index_sequence<count - half>{});
+    }
 }
 
 
-template <typename... Args>
+template <typename Policy = fold_sum, typename... Args>
+    requires summation_policy_v<Policy> &&
+             (std::is_arithmetic_v<Args> && ...) // ranges go to the span overloads below
 double pack_sum(Args... args)
 {
     static_assert(sizeof...(Args) > 0,
@@ -55,11 +139,34 @@ double pack_sum(Args... args)
     static_assert((std::is_same_v<Args, double> && ...),
                   "All arguments must be of type double");
 
-    return (args + ...);
+    if constexpr (std::is_same_v<Policy, fold_sum>)
+    {
+        return (args + ...);
+    }
+    else
+    {
+        const std::array<double, sizeof...(Args)> terms{args...};
+
+        if constexpr (std::is_same_v<Policy, pairwise_sum>)
+        {
+            return pairwise_pack<0>(terms, std::index_sequence_for<Args...>{});
+        }
+        else
+        {
+            compensated_sum<std::is_same_v<Policy, neumaier_sum>> total;
+            for (const double term : terms)
+            {
+                total.add(term);
+            }
+            return total.total();
+        }
+    }
 }
 
 
-template <typename... Args>
+template <typename Policy = fold_sum, typename... Args>
+    requires summation_policy_v<Policy> &&
+             (std::is_arithmetic_v<Args> && ...) // ranges go to the span overloads below
 double pack_mean(Args... args)
 {
     static_assert(sizeof...(Args) > 0,
@@ -67,7 +174,7 @@ double pack_mean(Args... args)
     static_assert((std::is_same_v<Args, double> && ...),
                   "All arguments must be of type double");
 
-    const double total = pack_sum(args...);
+    const double total = pack_sum<Policy>(args...);
 
     const double count = static_cast<double>(sizeof...(Args));
 
@@ -75,8 +182,914 @@ double pack_mean(Args... args)
     return total / count;
 }
 
-int main()
+// Range versions of the reductions above, for runtime arrays of samples.
+// AVX-512 or AVX2 kernels are picked at runtime; NaNs are not supported.
+// An empty range gives -inf (max), +inf (min), 0 (sum) and NaN (mean).
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PACK_X86_SIMD 1
+#else
+#define PACK_X86_SIMD 0
+#endif
+
+enum class simd_level
+{
+    none,
+    avx2,
+    avx512
+};
+
+// the widest kernels this CPU runs, asked once per process; range_extreme and
+// range_sum switch on it per call, so a build for plain x86-64 still reaches AVX-512
+inline simd_level cpu_simd_level()
+{
+    static const simd_level level = []
+    {
+#if PACK_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return simd_level::avx512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return simd_level::avx2;
+        }
+#endif
+        return simd_level::none;
+    }();
+    return level;
+}
+
+// independent accumulators per kernel, so the adds or compares of one step do not
+// wait for the previous step
+constexpr std::size_t ACCUMULATORS = 4;
+
+#if PACK_X86_SIMD
+
+// W lanes of T as one GCC vector. extreme_lanes, sum_lanes and compensated_lanes take
+// W = 256 or 512 bits worth of lanes and are inlined into the [[gnu::target]] entry
+// points below, which pick the instruction set
+template <typename T, std::size_t W>
+using simd_vec __attribute__((vector_size(W * sizeof(T)))) = T;
+
+// largest (MAX) or smallest element of data[0, n), n > 0
+template <bool MAX, typename T, std::size_t W>
+[[gnu::always_inline]] inline T extreme_lanes(const T* data, std::size_t n)
+{
+    using vec = simd_vec<T, W>;
+
+    const auto better = [](T lhs, T rhs)
+    {
+        return MAX ? (lhs > rhs) : (lhs < rhs);
+    };
+
+    T best = data[0];
+    std::size_t i = 0;
+
+    if (n >= ACCUMULATORS * W)
+    {
+        vec acc[ACCUMULATORS];
+        for (std::size_t k = 0; k < ACCUMULATORS; ++k)
+        {
+            std::memcpy(&acc[k], data + k * W, sizeof(vec));
+        }
+
+        for (i = ACCUMULATORS * W; i + ACCUMULATORS * W <= n; i += ACCUMULATORS * W)
+        {
+            for (std::size_t k = 0; k < ACCUMULATORS; ++k)
+            {
+                vec v;
+                std::memcpy(&v, data + i + k * W, sizeof(vec));
+                acc[k] = MAX ? (v > acc[k] ? v : acc[k]) : (v < acc[k] ? v : acc[k]);
+            }
+        }
+
+        for (std::size_t k = 1; k < ACCUMULATORS; ++k)
+        {
+            acc[0] = MAX ? (acc[k] > acc[0] ? acc[k] : acc[0]) : (acc[k] < acc[0] ? acc[k] : acc[0]);
+        }
+
+        best = acc[0][0];
+        for (std::size_t l = 1; l < W; ++l)
+        {
+            best = better(acc[0][l], best) ? acc[0][l] : best;
+        }
+    }
+
+    // scalar tail
+    for (; i < n; ++i)
+    {
+        best = better(data[i], best) ? data[i] : best;
+    }
+    return best;
+}
+
+// sum of data[0, n) in W double lanes; floats are widened before they are added
+template <typename T, std::size_t W>
+[[gnu::always_inline]] inline double sum_lanes(const T* data, std::size_t n)
+{
+    using vec = simd_vec<T, W>;
+    using acc_vec = simd_vec<double, W>;
+
+    acc_vec acc[ACCUMULATORS] = {};
+
+    std::size_t i = 0;
+    for (; i + ACCUMULATORS * W <= n; i += ACCUMULATORS * W)
+    {
+        for (std::size_t k = 0; k < ACCUMULATORS; ++k)
+        {
+            vec v;
+            std::memcpy(&v, data + i + k * W, sizeof(vec));
+            acc[k] += __builtin_convertvector(v, acc_vec);
+        }
+    }
+
+    // (a0 + a1) + (a2 + a3), then the lanes
+    acc[0] += acc[1];
+    acc[2] += acc[3];
+    acc[0] += acc[2];
+
+    double total = 0.0;
+    for (std::size_t l = 0; l < W; ++l)
+    {
+        total += acc[0][l];
+    }
+
+    // scalar tail
+    for (; i < n; ++i)
+    {
+        total += static_cast<double>(data[i]);
+    }
+    return total;
+}
+
+// sum_lanes with a compensation term per lane; the lanes and the tail are folded
+// into one scalar compensated_sum at the end
+template <bool NEUMAIER, typename T, std::size_t W>
+[[gnu::always_inline]] inline double compensated_lanes(const T* data, std::size_t n)
+{
+    using vec = simd_vec<T, W>;
+    using acc_vec = simd_vec<double, W>;
+
+    acc_vec sum[ACCUMULATORS]   = {};
+    acc_vec carry[ACCUMULATORS] = {};
+
+    std::size_t i = 0;
+    for (; i + ACCUMULATORS * W <= n; i += ACCUMULATORS * W)
+    {
+        for (std::size_t k = 0; k < ACCUMULATORS; ++k)
+        {
+            vec v;
+            std::memcpy(&v, data + i + k * W, sizeof(vec));
+            const acc_vec x = __builtin_convertvector(v, acc_vec);
+
+            if constexpr (NEUMAIER)
+            {
+                const acc_vec t     = sum[k] + x;
+                const acc_vec abs_s = sum[k] < 0.0 ? -sum[k] : sum[k];
+                const acc_vec abs_x = x < 0.0 ? -x : x;
+                carry[k] += abs_s >= abs_x ? (sum[k] - t) + x : (x - t) + sum[k];
+                sum[k]    = t;
+            }
+            else
+            {
+                const acc_vec y = x - carry[k];
+                const acc_vec t = sum[k] + y;
+                carry[k] = (t - sum[k]) - y;
+                sum[k]   = t;
+            }
+        }
+    }
+
+    compensated_sum<NEUMAIER> total;
+    for (std::size_t k = 0; k < ACCUMULATORS; ++k)
+    {
+        for (std::size_t l = 0; l < W; ++l)
+        {
+            total.add(sum[k][l]);
+            total.add(NEUMAIER ? carry[k][l] : -carry[k][l]);
+        }
+    }
+
+    // scalar tail
+    for (; i < n; ++i)
+    {
+        total.add(static_cast<double>(data[i]));
+    }
+    return total.total();
+}
+
+template <bool MAX, typename T>
+[[gnu::target("avx2")]] T extreme_avx2(const T* data, std::size_t n)
+{
+    return extreme_lanes<MAX, T, 32 / sizeof(T)>(data, n);
+}
+
+template <bool MAX, typename T>
+[[gnu::target("avx512f")]] T extreme_avx512(const T* data, std::size_t n)
+{
+    return extreme_lanes<MAX, T, 64 / sizeof(T)>(data, n);
+}
+
+template <typename T>
+[[gnu::target("avx2")]] double sum_avx2(const T* data, std::size_t n)
+{
+    return sum_lanes<T, 4>(data, n);
+}
+
+template <typename T>
+[[gnu::target("avx512f")]] double sum_avx512(const T* data, std::size_t n)
+{
+    return sum_lanes<T, 8>(data, n);
+}
+
+template <bool NEUMAIER, typename T>
+[[gnu::target("avx2")]] double compensated_avx2(const T* data, std::size_t n)
+{
+    return compensated_lanes<NEUMAIER, T, 4>(data, n);
+}
+
+template <bool NEUMAIER, typename T>
+[[gnu::target("avx512f")]] double compensated_avx512(const T* data, std::size_t n)
+{
+    return compensated_lanes<NEUMAIER, T, 8>(data, n);
+}
+
+#endif
+
+// the portable loops, taken where no SIMD level is available
+
+// largest (MAX) or smallest element of values, which is not empty
+template <bool MAX, typename T>
+T extreme_scalar(std::span<const T> values)
+{
+    T best = values[0];
+    for (const T value : values)
+    {
+        best = (MAX ? (value > best) : (value < best)) ? value : best;
+    }
+    return best;
+}
+
+template <typename T>
+double sum_scalar(std::span<const T> values)
+{
+    double total = 0.0;
+    for (const T value : values)
+    {
+        total += static_cast<double>(value);
+    }
+    return total;
+}
+
+template <bool NEUMAIER, typename T>
+double compensated_scalar(std::span<const T> values)
+{
+    compensated_sum<NEUMAIER> total;
+    for (const T value : values)
+    {
+        total.add(static_cast<double>(value));
+    }
+    return total.total();
+}
+
+template <bool MAX, typename T>
+T range_extreme(std::span<const T> values)
+{
+    if (values.empty())
+    {
+        return MAX ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+    }
+
+#if PACK_X86_SIMD
+    switch (cpu_simd_level())
+    {
+    case simd_level::avx512:
+        return extreme_avx512<MAX>(values.data(), values.size());
+    case simd_level::avx2:
+        return extreme_avx2<MAX>(values.data(), values.size());
+    case simd_level::none:
+        break;
+    }
+#endif
+
+    return extreme_scalar<MAX>(values);
+}
+
+template <typename Policy, typename T>
+double range_sum(std::span<const T> values)
+{
+    // blocks this small are summed directly by the pairwise recursion
+    constexpr std::size_t PAIRWISE_BLOCK = 1024;
+
+    if constexpr (std::is_same_v<Policy, pairwise_sum>)
+    {
+        if (values.size() <= PAIRWISE_BLOCK)
+        {
+            return range_sum<fold_sum>(values);
+        }
+        const std::size_t half = values.size() / 2;
+        return range_sum<pairwise_sum>(values.first(half)) + range_sum<pairwise_sum>(values.subspan(half));
+    }
+    else if constexpr (compensated_policy_v<Policy>)
+    {
+        constexpr bool NEUMAIER = std::is_same_v<Policy, neumaier_sum>;
+#if PACK_X86_SIMD
+        switch (cpu_simd_level())
+        {
+        case simd_level::avx512:
+            return compensated_avx512<NEUMAIER>(values.data(), values.size());
+        case simd_level::avx2:
+            return compensated_avx2<NEUMAIER>(values.data(), values.size());
+        case simd_level::none:
+            break;
+        }
+#endif
+
+        return compensated_scalar<NEUMAIER>(values);
+    }
+    else
+    {
+#if PACK_X86_SIMD
+        switch (cpu_simd_level())
+        {
+        case simd_level::avx512:
+            return sum_avx512(values.data(), values.size());
+        case simd_level::avx2:
+            return sum_avx2(values.data(), values.size());
+        case simd_level::none:
+            break;
+        }
+#endif
+
+        return sum_scalar(values);
+    }
+}
+
+double pack_max(std::span<const double> values)
+{
+    return range_extreme<true>(values);
+}
+
+float pack_max(std::span<const float> values)
+{
+    return range_extreme<true>(values);
+}
+
+double pack_min(std::span<const double> values)
+{
+    return range_extreme<false>(values);
+}
+
+float pack_min(std::span<const float> values)
+{
+    return range_extreme<false>(values);
+}
+
+// float samples are summed in double
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_sum(std::span<const double> values)
+{
+    return range_sum<Policy>(values);
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_sum(std::span<const float> values)
+{
+    return range_sum<Policy>(values);
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_mean(std::span<const double> values)
+{
+    return values.empty() ? std::numeric_limits<double>::quiet_NaN()
+                          : pack_sum<Policy>(values) / static_cast<double>(values.size());
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_mean(std::span<const float> values)
+{
+    return values.empty() ? std::numeric_limits<double>::quiet_NaN()
+                          : pack_sum<Policy>(values) / static_cast<double>(values.size());
+}
+
+// count, min, max, sum and variance in one pass over the samples; partial results
+// of separate chunks or threads are combined with merge()
+class running_stats
+{
+private:
+    std::size_t m_count = 0;
+    double      m_min   = std::numeric_limits<double>::infinity();
+    double      m_max   = -std::numeric_limits<double>::infinity();
+    double      m_sum   = 0.0;
+    double      m_mean  = 0.0;
+
+    // sum of squared deviations from m_mean (Welford)
+    double      m_m2    = 0.0;
+
+public:
+    // samples pushed as a span are handled in blocks of this size that stay in L1:
+    // the range kernels give min, max and sum of the block, one more loop its
+    // squared deviations, and the block is merged like a partial result
+    static constexpr std::size_t BLOCK = 512;
+
+    void push(double value)
+    {
+        ++m_count;
+        m_min  = (value < m_min) ? value : m_min;
+        m_max  = (value > m_max) ? value : m_max;
+        m_sum += value;
+
+        const double delta = value - m_mean;
+        m_mean += delta / static_cast<double>(m_count);
+        m_m2   += delta * (value - m_mean);
+    }
+
+    void push(std::span<const double> values)
+    {
+        for (std::size_t first = 0; first < values.size(); first += BLOCK)
+        {
+            const std::span<const double> block = values.subspan(first, std::min(BLOCK, values.size() - first));
+
+            running_stats part;
+            part.m_count = block.size();
+            part.m_min   = pack_min(block);
+            part.m_max   = pack_max(block);
+            part.m_sum   = pack_sum(block);
+            part.m_mean  = part.m_sum / static_cast<double>(part.m_count);
+
+            double m2[ACCUMULATORS] = {};
+            std::size_t i = 0;
+            for (; i + ACCUMULATORS <= block.size(); i += ACCUMULATORS)
+            {
+                for (std::size_t k = 0; k < ACCUMULATORS; ++k)
+                {
+                    const double delta = block[i + k] - part.m_mean;
+                    m2[k] += delta * delta;
+                }
+            }
+            for (; i < block.size(); ++i)
+            {
+                const double delta = block[i] - part.m_mean;
+                m2[0] += delta * delta;
+            }
+            part.m_m2 = (m2[0] + m2[1]) + (m2[2] + m2[3]);
+
+            merge(part);
+        }
+    }
+
+    // Chan et al.: the combined mean and squared deviations of both sample sets
+    void merge(const running_stats& other)
+    {
+        if (other.m_count == 0)
+        {
+            return;
+        }
+        if (m_count == 0)
+        {
+            *this = other;
+            return;
+        }
+
+        const double n_a   = static_cast<double>(m_count);
+        const double n_b   = static_cast<double>(other.m_count);
+        const double n     = n_a + n_b;
+        const double delta = other.m_mean - m_mean;
+
+        m_count += other.m_count;
+        m_min    = (other.m_min < m_min) ? other.m_min : m_min;
+        m_max    = (other.m_max > m_max) ? other.m_max : m_max;
+        m_sum   += other.m_sum;
+        m_mean  += delta * (n_b / n);
+        m_m2    += other.m_m2 + delta * delta * (n_a * n_b / n);
+    }
+
+    std::size_t count() const noexcept
+    {
+        return m_count;
+    }
+
+    // +inf / -inf while empty, as pack_min / pack_max of an empty range
+    double min() const noexcept
+    {
+        return m_min;
+    }
+
+    double max() const noexcept
+    {
+        return m_max;
+    }
+
+    double sum() const noexcept
+    {
+        return m_sum;
+    }
+
+    double mean() const noexcept
+    {
+        return (m_count != 0) ? m_mean : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // population variance (divides by count)
+    double variance() const noexcept
+    {
+        return (m_count != 0) ? m_m2 / static_cast<double>(m_count) : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // unbiased estimate (divides by count - 1)
+    double sample_variance() const noexcept
+    {
+        return (m_count > 1) ? m_m2 / static_cast<double>(m_count - 1) : std::numeric_limits<double>::quiet_NaN();
+    }
+};
+
+// Multi-threaded reductions for arrays too large for one core's bandwidth. The input
+// is cut into chunks of a fixed size whatever the thread count, workers claim chunks
+// in turn, and the per-chunk results are combined in chunk order, so a sum is
+// bit-identical for 1 or N threads (given the same SIMD level).
+struct parallel_reduction
+{
+    // 0 means one thread per CPU the process may run on
+    unsigned    threads = 0;
+
+    // elements per chunk: 32K doubles are 256 KiB, about one core's L2
+    std::size_t chunk   = std::size_t{1} << 15;
+
+    // helpers are bound to the CPUs of the affinity mask, one each (Linux only)
+    bool        pin     = true;
+};
+
+// the CPUs of the process affinity mask, read once (0 .. hardware_concurrency() - 1
+// where there is no mask)
+inline const std::vector<unsigned>& allowed_cpus()
+{
+    static const std::vector<unsigned> cpus = []
+    {
+        std::vector<unsigned> allowed;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+            for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    allowed.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (allowed.empty())
+        {
+            for (unsigned cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu)
+            {
+                allowed.push_back(cpu);
+            }
+        }
+        return allowed;
+    }();
+    return cpus;
+}
+
+inline void pin_this_thread([[maybe_unused]] unsigned cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    // best effort: a cpuset changed since the mask was read keeps the default placement
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+// Helper threads that live as long as the process, so a reduction does not start
+// threads of its own. With pin set, helper i binds itself to allowed_cpus()[i + 1]
+// (wrapping around) before it waits for work; the calling thread, which works too,
+// keeps its own placement. Reductions run one at a time.
+class reduction_pool
+{
+private:
+    bool                     m_pin;
+    std::vector<std::thread> m_helpers;
+
+    std::mutex               m_run;
+    std::mutex               m_lock;
+    std::condition_variable  m_wake;
+    std::condition_variable  m_done;
+
+    void                   (*m_call)(const void*) = nullptr;
+    const void*              m_work               = nullptr;
+    std::size_t              m_generation         = 0;
+    std::size_t              m_active             = 0;
+    std::size_t              m_pending            = 0;
+    bool                     m_stop               = false;
+
+    void helper_loop(std::size_t index)
+    {
+        if (m_pin)
+        {
+            const std::vector<unsigned>& cpus = allowed_cpus();
+            pin_this_thread(cpus[(index + 1) % cpus.size()]);
+        }
+
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> lock(m_lock);
+        for (;;)
+        {
+            m_wake.wait(lock, [&] { return m_stop || (m_generation != seen && index < m_active); });
+            if (m_stop)
+            {
+                return;
+            }
+            seen = m_generation;
+
+            lock.unlock();
+            m_call(m_work);
+            lock.lock();
+
+            if (--m_pending == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+
+public:
+    explicit reduction_pool(bool pin) : m_pin(pin) {}
+
+    reduction_pool(const reduction_pool&)            = delete;
+    reduction_pool& operator=(const reduction_pool&) = delete;
+
+    ~reduction_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& helper : m_helpers)
+        {
+            helper.join();
+        }
+    }
+
+    // work() on the calling thread and on `helpers` helper threads, returns once all
+    // of them are done; work must not start another reduction
+    template <typename Work>
+    void run(std::size_t helpers, const Work& work)
+    {
+        std::lock_guard<std::mutex> serial(m_run);
+        std::unique_lock<std::mutex> lock(m_lock);
+
+        while (m_helpers.size() < helpers)
+        {
+            m_helpers.emplace_back(&reduction_pool::helper_loop, this, m_helpers.size());
+        }
+
+        m_call    = [](const void* w) { (*static_cast<const Work*>(w))(); };
+        m_work    = &work;
+        m_active  = helpers;
+        m_pending = helpers;
+        ++m_generation;
+        lock.unlock();
+        m_wake.notify_all();
+
+        work();
+
+        lock.lock();
+        m_done.wait(lock, [this] { return m_pending == 0; });
+    }
+};
+
+inline reduction_pool& shared_reduction_pool(bool pin)
+{
+    static reduction_pool pinned(true);
+    static reduction_pool unpinned(false);
+    return pin ? pinned : unpinned;
+}
+
+// partial[c] = chunk_result(first, count) for every chunk c of [0, n)
+template <typename Result, typename ChunkFn>
+std::vector<Result> reduce_chunks(const parallel_reduction& policy, std::size_t n, ChunkFn chunk_result)
+{
+    const std::size_t chunk  = std::max<std::size_t>(policy.chunk, 1);
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+
+    std::vector<Result> partial(chunks);
+    std::atomic<std::size_t> next{0};
+
+    const auto work = [&]
+    {
+        for (std::size_t c = next.fetch_add(1, std::memory_order_relaxed); c < chunks;
+             c = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            partial[c] = chunk_result(c * chunk, std::min(chunk, n - c * chunk));
+        }
+    };
+
+    const std::size_t threads = (policy.threads != 0) ? policy.threads : allowed_cpus().size();
+    const std::size_t helpers = std::min<std::size_t>(threads, chunks) - (chunks != 0 ? 1 : 0);
+    if (helpers == 0)
+    {
+        work();
+    }
+    else
+    {
+        shared_reduction_pool(policy.pin).run(helpers, work);
+    }
+    return partial;
+}
+
+// sum of partial sums as a balanced tree over the chunk order
+inline double pairwise_total(std::span<const double> partial)
+{
+    if (partial.size() <= 2)
+    {
+        return partial.empty() ? 0.0 : (partial.size() == 1 ? partial[0] : partial[0] + partial[1]);
+    }
+    const std::size_t half = partial.size() / 2;
+    return pairwise_total(partial.first(half)) + pairwise_total(partial.subspan(half));
+}
+
+template <bool MAX, typename T>
+T parallel_extreme(const parallel_reduction& policy, std::span<const T> values)
+{
+    const std::vector<T> partial = reduce_chunks<T>(policy, values.size(), [values](std::size_t first, std::size_t count)
+    {
+        return range_extreme<MAX>(values.subspan(first, count));
+    });
+    return range_extreme<MAX>(std::span<const T>(partial));
+}
+
+template <typename Policy, typename T>
+double parallel_sum(const parallel_reduction& policy, std::span<const T> values)
+{
+    const std::vector<double> partial = reduce_chunks<double>(policy, values.size(), [values](std::size_t first, std::size_t count)
+    {
+        return range_sum<Policy>(values.subspan(first, count));
+    });
+
+    if constexpr (compensated_policy_v<Policy>)
+    {
+        compensated_sum<std::is_same_v<Policy, neumaier_sum>> total;
+        for (const double part : partial)
+        {
+            total.add(part);
+        }
+        return total.total();
+    }
+    else
+    {
+        return pairwise_total(partial);
+    }
+}
+
+double pack_max(const parallel_reduction& policy, std::span<const double> values)
+{
+    return parallel_extreme<true>(policy, values);
+}
+
+float pack_max(const parallel_reduction& policy, std::span<const float> values)
+{
+    return parallel_extreme<true>(policy, values);
+}
+
+double pack_min(const parallel_reduction& policy, std::span<const double> values)
+{
+    return parallel_extreme<false>(policy, values);
+}
+
+float pack_min(const parallel_reduction& policy, std::span<const float> values)
 {
+    return parallel_extreme<false>(policy, values);
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_sum(const parallel_reduction& policy, std::span<const double> values)
+{
+    return parallel_sum<Policy>(policy, values);
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_sum(const parallel_reduction& policy, std::span<const float> values)
+{
+    return parallel_sum<Policy>(policy, values);
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_mean(const parallel_reduction& policy, std::span<const double> values)
+{
+    return values.empty() ? std::numeric_limits<double>::quiet_NaN()
+                          : pack_sum<Policy>(policy, values) / static_cast<double>(values.size());
+}
+
+template <typename Policy = fold_sum>
+    requires summation_policy_v<Policy>
+double pack_mean(const parallel_reduction& policy, std::span<const float> values)
+{
+    return values.empty() ? std::numeric_limits<double>::quiet_NaN()
+                          : pack_sum<Policy>(policy, values) / static_cast<double>(values.size());
+}
+
+// every statistic in one parallel pass; chunks are merged in order, so the result
+// does not depend on the thread count either
+inline running_stats pack_stats(const parallel_reduction& policy, std::span<const double> values)
+{
+    const std::vector<running_stats> partial = reduce_chunks<running_stats>(policy, values.size(), [values](std::size_t first, std::size_t count)
+    {
+        running_stats part;
+        part.push(values.subspan(first, count));
+        return part;
+    });
+
+    running_stats total;
+    for (const running_stats& part : partial)
+    {
+        total.merge(part);
+    }
+    return total;
+}
+
+#ifdef PACK_BENCH
+
+// -DPACK_BENCH (the "Bench" target) turns main into a scaling run: sum, max and stats
+// over one array for 1 up to as many threads as the affinity mask has CPUs, each row
+// "reduction,threads,seconds,gb_per_s,result" on stdout, the best of three repeats.
+// A sum that changes with the thread count fails the run.
+//   04-02 [elements]      array size in doubles (default 2^27, 1 GiB)
+static int run_benchmarks(int argc, char* argv[])
+{
+    using clock = std::chrono::steady_clock;
+
+    const std::size_t n = (argc > 1) ? static_cast<std::size_t>(std::stod(argv[1])) : std::size_t{1} << 27;
+
+    std::vector<double> values(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        values[i] = static_cast<double>((i * 2'654'435'761u) % 1'000'003) * 1e-3;
+    }
+
+    const unsigned max_threads = static_cast<unsigned>(allowed_cpus().size());
+
+    std::cout << "reduction,threads,seconds,gb_per_s,result\n";
+
+    double reference = 0.0;
+    for (unsigned threads = 1; threads <= max_threads; ++threads)
+    {
+        const parallel_reduction policy{threads};
+
+        const auto row = [&](const char* name, auto reduce)
+        {
+            double best   = std::numeric_limits<double>::max();
+            double result = 0.0;
+            for (int rep = 0; rep < 3; ++rep)
+            {
+                const clock::time_point start = clock::now();
+                result = reduce();
+                best   = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+            }
+            std::cout << name << ',' << threads << ',' << best << ','
+                      << static_cast<double>(n * sizeof(double)) / best * 1e-9 << ','
+                      << result << std::endl;
+            return result;
+        };
+
+        const double sum = row("sum", [&] { return pack_sum(policy, values); });
+        row("max", [&] { return pack_max(policy, values); });
+        row("stats", [&] { return pack_stats(policy, values).variance(); });
+
+        if (threads == 1)
+        {
+            reference = sum;
+        }
+        else if (sum != reference)
+        {
+            std::cerr << "sum differs with " << threads << " threads\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+#ifdef PACK_BENCH
+    return run_benchmarks(argc, argv);
+#endif
+
     // tests for maximum
     {
         const double m1 = pack_max(1.0);
@@ -125,6 +1138,214 @@ int main()
         // sum = 8, count = 4, mean = 2
         assert(almost_equal(a3, 2.0));
     }
+    // range overloads agree with the packs on the cases above
+    {
+        const std::vector<double> r1{1.0, 2.0, 3.5, -4.0};
+        assert(pack_max(r1) == pack_max(1.0, 2.0, 3.5, -4.0));
+        assert(pack_min(r1) == pack_min(1.0, 2.0, 3.5, -4.0));
+
+        const std::vector<double> r2{-10.0, -5.0, -7.0};
+        assert(pack_max(r2) == pack_max(-10.0, -5.0, -7.0));
+
+        const std::vector<double> r3{10.0, 5.0, 7.0};
+        assert(pack_min(r3) == pack_min(10.0, 5.0, 7.0));
+
+        const std::vector<double> r4{-1.0, 1.0, 2.5};
+        assert(pack_sum(r4) == pack_sum(-1.0, 1.0, 2.5));
+
+        const std::vector<double> r5{-1.0, 1.0, 3.0, 5.0};
+        assert(pack_mean(r5) == pack_mean(-1.0, 1.0, 3.0, 5.0));
+
+        const std::vector<float> f5{-1.0f, 1.0f, 3.0f, 5.0f};
+        assert(pack_max(f5) == 5.0f && pack_min(f5) == -1.0f);
+        assert(pack_mean(f5) == 2.0);
+
+        assert(pack_max(std::span<const double>{}) == -std::numeric_limits<double>::infinity());
+        assert(pack_sum(std::span<const float>{}) == 0.0);
+        assert(std::isnan(pack_mean(std::span<const double>{})));
+    }
+
+    // every length around the vector widths, extremes at every position
+    {
+        for (std::size_t n = 1; n <= 300; ++n)
+        {
+            std::vector<double> d(n);
+            std::vector<float>  f(n);
+            double expected_sum = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                d[i] = static_cast<double>((i * 37) % 101) - 50.0;
+                f[i] = static_cast<float>(d[i]);
+                expected_sum += d[i];
+            }
+            d[(n * 7) % n] = 1000.0;
+            f[(n * 3) % n] = -1000.0f;
+            expected_sum += 1000.0 - static_cast<double>(((n * 7) % n * 37) % 101) + 50.0;
+
+            assert(pack_max(d) == 1000.0);
+            assert(pack_min(f) == -1000.0f);
+            assert(almost_equal(pack_sum(d), expected_sum));
+            assert(almost_equal(pack_mean(d), expected_sum / static_cast<double>(n)));
+        }
+    }
+    // the scalar loops and the AVX2 kernels, called directly whatever level the packs
+    // dispatch to: whole numbers add up exactly in every order, so all of them agree
+    {
+        for (std::size_t n = 1; n <= 300; ++n)
+        {
+            std::vector<double> d(n);
+            std::vector<float>  f(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                d[i] = static_cast<double>((i * 53) % 211) - 105.0;
+                f[i] = static_cast<float>((i * 29) % 97) - 48.0f;
+            }
+            const std::span<const double> ds(d);
+            const std::span<const float>  fs(f);
+
+            assert(extreme_scalar<true>(ds) == pack_max(d) && extreme_scalar<false>(ds) == pack_min(d));
+            assert(extreme_scalar<true>(fs) == pack_max(f) && extreme_scalar<false>(fs) == pack_min(f));
+            assert(sum_scalar(ds) == pack_sum(d) && sum_scalar(fs) == pack_sum(f));
+            assert(compensated_scalar<true>(ds) == pack_sum<neumaier_sum>(d));
+            assert(compensated_scalar<false>(fs) == pack_sum<kahan_sum>(f));
+
+#if PACK_X86_SIMD
+            if (__builtin_cpu_supports("avx2"))
+            {
+                assert(extreme_avx2<true>(d.data(), n) == pack_max(d) && extreme_avx2<false>(d.data(), n) == pack_min(d));
+                assert(extreme_avx2<true>(f.data(), n) == pack_max(f) && extreme_avx2<false>(f.data(), n) == pack_min(f));
+                assert(sum_avx2(d.data(), n) == pack_sum(d) && sum_avx2(f.data(), n) == pack_sum(f));
+                assert(compensated_avx2<true>(d.data(), n) == pack_sum<neumaier_sum>(d));
+                assert(compensated_avx2<false>(f.data(), n) == pack_sum<kahan_sum>(f));
+            }
+#endif
+        }
+
+        const std::vector<double> tenths(100'003, 0.1);
+        const double reference = static_cast<double>(static_cast<long double>(0.1) * 100'003.0L);
+        assert(compensated_scalar<false>(std::span<const double>(tenths)) == reference);
+#if PACK_X86_SIMD
+        if (__builtin_cpu_supports("avx2"))
+        {
+            const double plain = std::abs(sum_avx2(tenths.data(), tenths.size()) - reference);
+            assert(std::abs(compensated_avx2<false>(tenths.data(), tenths.size()) - reference) <= plain);
+            assert(std::abs(compensated_avx2<true>(tenths.data(), tenths.size()) - reference) <= plain);
+        }
+#endif
+    }
+    // fused statistics: one value at a time, a whole span, and merged halves agree
+    {
+        running_stats one;
+        one.push(-1.0);
+        one.push(1.0);
+        one.push(3.0);
+        one.push(5.0);
+        assert(one.count() == 4);
+        assert(almost_equal(one.min(), pack_min(-1.0, 1.0, 3.0, 5.0)));
+        assert(almost_equal(one.max(), pack_max(-1.0, 1.0, 3.0, 5.0)));
+        assert(almost_equal(one.sum(), pack_sum(-1.0, 1.0, 3.0, 5.0)));
+        assert(almost_equal(one.mean(), pack_mean(-1.0, 1.0, 3.0, 5.0)));
+        assert(almost_equal(one.variance(), 5.0));
+        assert(almost_equal(one.sample_variance(), 20.0 / 3.0));
+
+        std::vector<double> samples(10'000);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            samples[i] = 1e6 + static_cast<double>((i * 7'919) % 1'000) * 0.01;
+        }
+
+        running_stats streamed;
+        for (const double x : samples)
+        {
+            streamed.push(x);
+        }
+
+        running_stats spanned;
+        spanned.push(samples);
+
+        running_stats left;
+        running_stats right;
+        left.push(std::span<const double>(samples).first(3'333));
+        right.push(std::span<const double>(samples).subspan(3'333));
+        left.merge(right);
+
+        for (const running_stats& s : {spanned, left})
+        {
+            assert(s.count() == streamed.count());
+            assert(s.min() == streamed.min() && s.max() == streamed.max());
+            assert(almost_equal(s.mean(), streamed.mean(), 1e-6));
+            assert(almost_equal(s.variance(), streamed.variance(), 1e-6));
+        }
+        assert(almost_equal(streamed.variance(), 8.333325, 1e-6));
+
+        running_stats empty;
+        assert(std::isnan(empty.mean()));
+        empty.merge(one);
+        assert(empty.count() == 4 && almost_equal(empty.variance(), 5.0));
+    }
+    // summation policies: the fold cancels the small term, Neumaier keeps it
+    {
+        assert(pack_sum(1e16, 1.0, -1e16) == 0.0);
+        assert(pack_sum<neumaier_sum>(1e16, 1.0, -1e16) == 1.0);
+        assert(pack_sum<pairwise_sum>(1.0, 2.0, 3.0) == 6.0);
+        static_assert(pairwise_pack<0>(std::array{1.0, 2.0, 3.0, 4.0, 5.0}, std::make_index_sequence<5>{}) == 15.0);
+        assert(pack_sum<kahan_sum>(-1.0, 1.0, 2.5) == 2.5);
+        assert(pack_mean<pairwise_sum>(-1.0, 1.0, 3.0, 5.0) == 2.0);
+        assert(pack_mean<neumaier_sum>(1.0) == 1.0);
+
+        // 0.1 is not exact in binary: a million of them drift under a plain sum
+        const std::vector<double> tenths(1'000'000, 0.1);
+        const double reference  = static_cast<double>(static_cast<long double>(0.1) * 1e6L);
+        const double plain      = std::abs(static_cast<double>(pack_sum(tenths) - reference));
+        const double loop_error = std::abs(static_cast<double>([&] { double t = 0.0; for (const double x : tenths) t += x; return t; }() - reference));
+
+        assert(pack_sum<kahan_sum>(tenths) == reference);
+        assert(pack_sum<neumaier_sum>(tenths) == reference);
+        assert(std::abs(pack_sum<pairwise_sum>(tenths) - reference) <= loop_error);
+        assert(plain <= loop_error);
+
+        std::vector<float> mixed(100'003);
+        for (std::size_t i = 0; i < mixed.size(); ++i)
+        {
+            mixed[i] = (i % 2 == 0) ? 1e8f : -1e8f + 0.25f * static_cast<float>(i % 7);
+        }
+        const parallel_reduction policy{4, 4'096};
+        assert(almost_equal(pack_sum<neumaier_sum>(policy, mixed), pack_sum<neumaier_sum>(mixed)));
+        assert(almost_equal(pack_mean<kahan_sum>(policy, mixed), pack_mean<neumaier_sum>(mixed)));
+    }
+
+    // parallel reductions give the same bits for every thread count
+    {
+        std::vector<double> samples(1'000'003);
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            samples[i] = std::sin(static_cast<double>(i)) * 1e3;
+        }
+        const std::vector<float> floats(samples.begin(), samples.end());
+
+        const parallel_reduction single{1, 4'096};
+        const double sum = pack_sum(single, samples);
+        assert(almost_equal(sum, pack_sum(samples), 1e-6));
+
+        for (unsigned threads = 2; threads <= 8; threads *= 2)
+        {
+            const parallel_reduction policy{threads, 4'096};
+            assert(pack_sum(policy, samples) == sum);
+            assert(pack_sum(policy, floats) == pack_sum(single, floats));
+            assert(pack_max(policy, samples) == pack_max(samples));
+            assert(pack_min(policy, floats) == pack_min(floats));
+            assert(pack_mean(policy, samples) == sum / static_cast<double>(samples.size()));
+
+            const running_stats stats = pack_stats(policy, samples);
+            assert(stats.count() == samples.size() && stats.max() == pack_max(samples));
+            assert(stats.variance() == pack_stats(single, samples).variance());
+        }
+
+        // unpinned helpers come from a pool of their own
+        assert(pack_sum(parallel_reduction{4, 4'096, false}, samples) == sum);
+
+        assert(pack_sum(parallel_reduction{}, std::span<const double>{}) == 0.0);
+    }
     std::cout << "All tests passed\n";
 
     return 0;
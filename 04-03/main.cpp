@@ -1,18 +1,58 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <concepts>
 #include <cstddef>
 #include <iostream>
+#include <list>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+// only arguments that are exactly int (after dropping references and const) are pushed
+template <typename T>
+inline constexpr bool is_int_v = std::is_same_v<std::remove_cvref_t<T>, int>;
+
+template <typename Container>
+concept reservable = requires(Container& container, std::size_t n)
+{
+    container.reserve(n);
+    { container.capacity() } -> std::convertible_to<std::size_t>;
+    { container.size() }     -> std::convertible_to<std::size_t>;
+};
+
+template <typename Container>
+concept range_insertable = requires(Container& container, const int* first)
+{
+    container.insert(container.end(), first, first);
+};
+
+// makes room for extra more elements with at most one allocation,
+// growing geometrically so that many small calls stay amortised O(1)
 template <typename Container>
-void handle(Container& container, int value)
+void reserve_for(Container& container, std::size_t extra)
 {
-    container.push_back(value);
+    if constexpr (reservable<Container>)
+    {
+        const std::size_t needed   = container.size() + extra;
+        const std::size_t capacity = container.capacity();
+
+        if (needed > capacity)
+        {
+            container.reserve(std::max(needed, capacity * 2U));
+        }
+    }
 }
 
-template <typename Container, typename T>
-void handle(Container&, const T&)
+template <std::size_t N, typename T>
+void handle(std::array<int, N>& ints, std::size_t& next, const T& value)
 {
+    if constexpr (is_int_v<T>)
+    {
+        ints[next++] = value;
+    }
 }
 
 template <typename Container, typename... Args>
@@ -21,7 +61,97 @@ void push_ints(Container& container, Args&&... args)
     // ensure that at least one argument is passed to the function
     static_assert(sizeof...(Args) > 0U,
                   "Push_ints requires at least one argument");
-    (handle(container, std::forward<Args>(args)), ...);
+
+    constexpr std::size_t COUNT = (std::size_t{0U} + ... + std::size_t{is_int_v<Args>});
+
+    if constexpr (COUNT > 0U)
+    {
+        // gather the ints first so the container sees one reservation and one insertion
+        std::array<int, COUNT> ints{};
+        std::size_t next = 0U;
+        (handle(ints, next, args), ...);
+
+        reserve_for(container, COUNT);
+
+        if constexpr (range_insertable<Container>)
+        {
+            container.insert(container.end(), ints.begin(), ints.end());
+        }
+        else
+        {
+            for (int value : ints)
+            {
+                container.push_back(value);
+            }
+        }
+    }
+}
+
+// number of arguments whose type is exactly T
+template <typename T, typename... Args>
+inline constexpr std::size_t count_of_v =
+    (std::size_t{0U} + ... + std::size_t{std::is_same_v<std::remove_cvref_t<Args>, T>});
+
+// position of T in Ts, or sizeof...(Ts) when T is not there
+template <typename T, typename... Ts>
+constexpr std::size_t index_of()
+{
+    constexpr std::array<bool, sizeof...(Ts)> matches{std::is_same_v<T, Ts>...};
+
+    for (std::size_t i = 0U; i < matches.size(); ++i)
+    {
+        if (matches[i])
+        {
+            return i;
+        }
+    }
+    return sizeof...(Ts);
+}
+
+// sink for scatter that drops arguments no container takes
+struct discard
+{
+    template <typename T>
+    void operator()(T&&) const noexcept
+    {
+    }
+};
+
+template <typename Sink, typename Arg, typename... Containers>
+void route(std::tuple<Containers&...>& targets, Sink& sink, Arg&& arg)
+{
+    constexpr std::size_t I =
+        index_of<std::remove_cvref_t<Arg>, typename Containers::value_type...>();
+
+    if constexpr (I < sizeof...(Containers))
+    {
+        std::get<I>(targets).push_back(std::forward<Arg>(arg));
+    }
+    else
+    {
+        sink(std::forward<Arg>(arg));
+    }
+}
+
+// sends every argument to the container whose value_type is exactly its type,
+// in one pass and in argument order; anything unmatched goes to sink.
+// each container is reserved once for its share, counted at compile time
+template <typename... Containers, typename Sink, typename... Args>
+void scatter(std::tuple<Containers&...> targets, Sink&& sink, Args&&... args)
+{
+    static_assert(((count_of_v<typename Containers::value_type,
+                               typename Containers::value_type...> == 1U) && ...),
+                  "scatter requires containers with distinct value types");
+
+    std::apply([](auto&... container)
+               {
+                   (reserve_for(container,
+                                count_of_v<typename std::remove_cvref_t<decltype(container)>::value_type,
+                                           Args...>), ...);
+               },
+               targets);
+
+    (route(targets, sink, std::forward<Args>(args)), ...);
 }
 
 bool vector_equals(const std::vector<int>& v, const std::vector<int>& expected)
@@ -41,6 +171,57 @@ bool vector_equals(const std::vector<int>& v, const std::vector<int>& expected)
     return true;
 }
 
+// Vector-like container without insert (like Vector from 04-04) that counts its allocations
+class counting_vector
+{
+public:
+    using value_type = int;
+
+    void reserve(std::size_t n)
+    {
+        if (n > m_capacity)
+        {
+            m_capacity = n;
+            ++m_allocations;
+        }
+        m_values.reserve(n);
+    }
+
+    void push_back(int value)
+    {
+        if (m_values.size() == m_capacity)
+        {
+            reserve((m_capacity == 0U) ? 1U : m_capacity * 2U);
+        }
+        m_values.push_back(value);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return m_values.size();
+    }
+
+    std::size_t capacity() const noexcept
+    {
+        return m_capacity;
+    }
+
+    std::size_t allocations() const noexcept
+    {
+        return m_allocations;
+    }
+
+    const std::vector<int>& values() const noexcept
+    {
+        return m_values;
+    }
+
+private:
+    std::vector<int> m_values;
+    std::size_t      m_capacity    = 0U;
+    std::size_t      m_allocations = 0U;
+};
+
 int main()
 {
     // test 1
@@ -83,6 +264,94 @@ int main()
         assert(vector_equals(v, expected));
     }
 
+    // test 4: one allocation per call, whatever the number of ints
+    {
+        counting_vector v;
+        const int   four  = 4;
+        const short small = 9;
+
+        push_ints(v, 1, 2.5, 2, "skip", 3, four, small, 5);
+
+        assert(v.allocations() == 1U);
+        assert(v.capacity() == 5U);
+        assert(vector_equals(v.values(), {1, 2, 3, 4, 5}));
+
+        push_ints(v, 6, 7);
+        assert(v.allocations() == 2U);
+
+        push_ints(v, 'x', 1.0);
+        assert(v.allocations() == 2U);
+        assert(vector_equals(v.values(), {1, 2, 3, 4, 5, 6, 7}));
+    }
+
+    // test 5: std::vector gets one reservation, containers without reserve still work
+    {
+        std::vector<int> v;
+
+        push_ints(v, 1, 2, 3, 4, 5, 6, 7, 8);
+        assert(v.capacity() == 8U);
+
+        // room reserved up front is used in place, without reallocating
+        v.reserve(16U);
+        const int* const data = v.data();
+        push_ints(v, 9, "skip", 10, 11, 12, 13, 14, 15, 16);
+        assert(v.data() == data && v.size() == 16U);
+
+        // one int per call still grows geometrically: 32, 64, ..., 1024
+        std::size_t reallocations = 0U;
+        for (int i = 0; i < 1000; ++i)
+        {
+            const int* const before = v.data();
+            push_ints(v, i);
+            reallocations += (v.data() != before) ? 1U : 0U;
+        }
+        assert(reallocations <= 6U);
+        assert(v.size() == 1016U && v[15] == 16 && v.back() == 999);
+
+        std::list<int> l{0};
+        push_ints(l, 1, 'c', 2);
+        assert(vector_equals(std::vector<int>(l.begin(), l.end()), {0, 1, 2}));
+    }
+
+    // test 6: scatter routes each argument by type in one pass
+    {
+        std::vector<int>         ints{0};
+        std::vector<double>      doubles;
+        std::vector<std::string> strings;
+        std::vector<char>        unmatched;
+
+        std::string moved = "moved";
+
+        scatter(std::tie(ints, doubles, strings),
+                [&unmatched](auto&& value)
+                {
+                    if constexpr (std::is_same_v<std::remove_cvref_t<decltype(value)>, char>)
+                    {
+                        unmatched.push_back(value);
+                    }
+                },
+                1, 2.5, std::string("a"), 'x', 3, std::move(moved), -0.5, "literal", 'y');
+
+        assert(vector_equals(ints, {0, 1, 3}));
+        assert(doubles == std::vector<double>({2.5, -0.5}));
+        assert(strings == std::vector<std::string>({"a", "moved"}));
+        assert(unmatched == std::vector<char>({'x', 'y'}));
+        assert(doubles.capacity() == 2U);
+        assert(strings.capacity() == 2U);
+    }
+
+    // test 7: a container that only has push_back/reserve gets one allocation
+    {
+        counting_vector     ints;
+        std::list<double>   doubles;
+
+        scatter(std::tie(ints, doubles), discard{}, 1, 2, 3.0, "skip", 4, 5, 6);
+
+        assert(ints.allocations() == 1U);
+        assert(vector_equals(ints.values(), {1, 2, 4, 5, 6}));
+        assert(doubles.size() == 1U && doubles.front() == 3.0);
+    }
+
     std::cout << "All tests passed\n";
 
 
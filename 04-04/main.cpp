@@ -84,6 +84,15 @@ public:
         ++m_size;                // logical size increases by one
     }
 
+    // grows capacity to at least new_cap in one allocation, never shrinks
+    void reserve(std::size_t new_cap)
+    {
+        if (new_cap > m_capacity)
+        {
+            reallocate_to(new_cap);
+        }
+    }
+
     // does not free memory, only resets size to zero
     void clear() noexcept
     {
@@ -194,6 +203,26 @@ int main()
         assert(v.empty());
     }
 
+    // reserve allocates once and keeps the elements
+    {
+        Vector<int> v{1, 2};
+        v.reserve(10U);
+        assert(v.capacity() == 10U);
+        assert(v.size() == 2U);
+        assert(v[0] == 1);
+        assert(v[1] == 2);
+
+        for (int i = 0; i < 8; ++i)
+        {
+            v.push_back(i);
+        }
+        assert(v.capacity() == 10U);
+
+        v.reserve(4U);
+        assert(v.capacity() == 10U);
+        assert(v.size() == 10U);
+    }
+
     {
         Vector<double> vd{1.5, 2.5, 3.5};
         assert(vd.size() == 3U);